@@ -0,0 +1,179 @@
+/**
+ * Single core decode throughput of MS-ADPCM and IMA ADPCM files through
+ * drwav_read_s16() and drwav_read_f32(), read in 4096-sample chunks like
+ * the streamer does.
+ *
+ * The files have valid block headers and random nibbles. Nibbles of real
+ * audio are close to random too, so the decoder's branches see about the
+ * same patterns.
+ */
+#define DR_WAV_IMPLEMENTATION
+#include "dr_wav.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// blocks per file, 2 KB stereo blocks hold about 2000 frames
+static const int BLOCKS = 16384;
+static const size_t CHUNK_SAMPLES = 4096;
+static const int RUNS = 3;
+
+static uint32_t seed = 1;
+
+static uint32_t random32() {
+	seed = seed * 1664525 + 1013904223;
+	return seed;
+}
+
+static void put16(std::vector<uint8_t>& out, uint32_t value) {
+	out.push_back(value);
+	out.push_back(value >> 8);
+}
+
+static void put32(std::vector<uint8_t>& out, uint32_t value) {
+	put16(out, value);
+	put16(out, value >> 16);
+}
+
+static void putTag(std::vector<uint8_t>& out, const char* tag) {
+	out.insert(out.end(), tag, tag + 4);
+}
+
+/**
+ * Write an ADPCM file of random blocks.
+ * @param isIma True for IMA ADPCM, false for MS-ADPCM.
+ * @returns The number of samples in the file, 0 if it could not be written.
+ */
+static drwav_uint64 writeFile(const std::string& path, bool isIma, int channels) {
+	static const int16_t MS_COEFFICIENTS[7][2] = {{256, 0}, {512, -256}, {0, 0}, {192, 64}, {240, 0}, {460, -208}, {392, -232}};
+	uint32_t blockAlign = 1024 * channels;
+	uint32_t headerSize = (isIma ? 4 : 7) * channels;
+	uint32_t samplesPerBlock = isIma ? ((blockAlign - headerSize) * 2 + channels) / channels : (blockAlign - headerSize) * 2 / channels + 2;
+
+	std::vector<uint8_t> format;
+	put16(format, isIma ? DR_WAVE_FORMAT_DVI_ADPCM : DR_WAVE_FORMAT_ADPCM);
+	put16(format, channels);
+	put32(format, 44100);
+	put32(format, 44100 * blockAlign / samplesPerBlock);
+	put16(format, blockAlign);
+	put16(format, 4);
+	if (isIma) {
+		put16(format, 2);
+		put16(format, samplesPerBlock);
+	} else {
+		put16(format, 4 + sizeof(MS_COEFFICIENTS));
+		put16(format, samplesPerBlock);
+		put16(format, 7);
+		for (auto& coefficients : MS_COEFFICIENTS) {
+			put16(format, coefficients[0]);
+			put16(format, coefficients[1]);
+		}
+	}
+
+	std::vector<uint8_t> data;
+	for (int block = 0; block < BLOCKS; block++) {
+		size_t start = data.size();
+		if (isIma) {
+			for (int c = 0; c < channels; c++) {
+				put16(data, random32() >> 16);
+				data.push_back(random32() % 89);
+				data.push_back(0);
+			}
+		} else {
+			for (int c = 0; c < channels; c++) {
+				data.push_back(random32() % 7);
+			}
+			for (int c = 0; c < channels; c++) {
+				put16(data, 16 + random32() % 3000);
+			}
+			for (int i = 0; i < 2 * channels; i++) {
+				put16(data, random32() >> 16);
+			}
+		}
+		while (data.size() - start < blockAlign) {
+			data.push_back(random32() >> 24);
+		}
+	}
+
+	std::vector<uint8_t> file;
+	putTag(file, "RIFF");
+	put32(file, 4 + 8 + format.size() + 12 + 8 + data.size());
+	putTag(file, "WAVE");
+	putTag(file, "fmt ");
+	put32(file, format.size());
+	file.insert(file.end(), format.begin(), format.end());
+	putTag(file, "fact");
+	put32(file, 4);
+	put32(file, BLOCKS * samplesPerBlock);
+	putTag(file, "data");
+	put32(file, data.size());
+	file.insert(file.end(), data.begin(), data.end());
+
+	FILE* out = fopen(path.c_str(), "wb");
+	if (!out) {
+		return 0;
+	}
+	bool isWritten = fwrite(file.data(), 1, file.size(), out) == file.size();
+	fclose(out);
+	return isWritten ? (drwav_uint64) BLOCKS * samplesPerBlock * channels : 0;
+}
+
+/**
+ * Decode a whole file in chunks.
+ * @returns Milliseconds of the fastest run, a negative value on a short read.
+ */
+template <typename T>
+static double decode(const std::string& path, drwav_uint64 samples, drwav_uint64 (*read)(drwav*, drwav_uint64, T*)) {
+	std::vector<T> chunk(CHUNK_SAMPLES);
+	double best = 1e9;
+	for (int run = 0; run < RUNS; run++) {
+		drwav wav;
+		if (!drwav_init_file(&wav, path.c_str())) {
+			return -1;
+		}
+		drwav_uint64 total = 0;
+		auto start = std::chrono::steady_clock::now();
+		drwav_uint64 count;
+		while ((count = read(&wav, chunk.size(), chunk.data())) > 0) {
+			total += count;
+		}
+		best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		drwav_uninit(&wav);
+		if (total != samples) {
+			return -1;
+		}
+	}
+	return best;
+}
+
+int main(int argc, char** argv) {
+	std::string directory = argc > 1 ? argv[1] : "/tmp";
+	int result = 0;
+
+	printf("%d blocks per file, %zu-sample reads, best of %d runs\n", BLOCKS, CHUNK_SAMPLES, RUNS);
+	for (int isIma = 0; isIma < 2; isIma++) {
+		for (int channels = 1; channels <= 2; channels++) {
+			const char* name = isIma ? "IMA" : "MS-ADPCM";
+			std::string path = directory + "/adpcm_bench.wav";
+			drwav_uint64 samples = writeFile(path, isIma, channels);
+			if (samples == 0) {
+				fprintf(stderr, "could not write %s\n", path.c_str());
+				return 1;
+			}
+			double s16 = decode<drwav_int16>(path, samples, drwav_read_s16);
+			double f32 = decode<float>(path, samples, drwav_read_f32);
+			remove(path.c_str());
+			if (s16 < 0 || f32 < 0) {
+				printf("%-8s %d ch: short read\n", name, channels);
+				result = 1;
+				continue;
+			}
+			printf("%-8s %d ch  %9llu samples  s16 %7.1f ms %5.0f Msamples/s  f32 %7.1f ms %5.0f Msamples/s\n", name, channels,
+				(unsigned long long) samples, s16, samples / s16 / 1000, f32, samples / f32 / 1000);
+		}
+	}
+	return result;
+}
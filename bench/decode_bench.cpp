@@ -0,0 +1,131 @@
+/**
+ * Load time and peak memory of decoding a Wav file into memory, the way
+ * loadWavFile() used to do it and through SampleCache.
+ *
+ * before: drwav_open_and_read_file_f32() into a temporary array, copied into
+ *         the play buffer one push_back() at a time
+ * after:  SampleCache::load(), sized once from the header and decoded
+ *         straight into the planes
+ *
+ * Every run is a child process of its own, so its peak RSS is the peak of
+ * that one load.
+ */
+#include "SampleCache.hpp"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define DR_WAV_IMPLEMENTATION
+#include "dr_wav.h"
+
+// 10 minutes of stereo 48 kHz 16-bit audio, 110 MB on disk and 220 MB decoded
+static const drwav_uint64 FRAMES = 48000 * 600;
+static const int RUNS = 3;
+
+static bool writeFile(const std::string& path) {
+	drwav_data_format format;
+	format.container = drwav_container_riff;
+	format.format = DR_WAVE_FORMAT_PCM;
+	format.channels = 2;
+	format.sampleRate = 48000;
+	format.bitsPerSample = 16;
+	drwav* wav = drwav_open_file_write(path.c_str(), &format);
+	if (!wav) {
+		return false;
+	}
+	std::vector<drwav_int16> block(65536);
+	uint32_t seed = 1;
+	for (drwav_uint64 written = 0; written < FRAMES * 2; written += block.size()) {
+		for (drwav_int16& sample : block) {
+			seed = seed * 1664525 + 1013904223;
+			sample = (drwav_int16) (seed >> 16);
+		}
+		drwav_write(wav, block.size(), block.data());
+	}
+	drwav_close(wav);
+	return true;
+}
+
+static void loadBefore(const std::string& path) {
+	unsigned int channels;
+	unsigned int sampleRate;
+	drwav_uint64 totalSampleCount;
+	float* samples = drwav_open_and_read_file_f32(path.c_str(), &channels, &sampleRate, &totalSampleCount);
+	std::vector<float> playBuffer;
+	for (drwav_uint64 i = 0; i < totalSampleCount; i++) {
+		playBuffer.push_back(samples[i]);
+	}
+	drwav_free(samples);
+}
+
+static void loadAfter(const std::string& path) {
+	std::shared_ptr<const SampleData> data = SampleCache::global().load(path);
+}
+
+/**
+ * Load the file in a child process.
+ * @param load Load function.
+ * @param milliseconds Receives the load time.
+ * @param peakMegabytes Receives the peak RSS of the child.
+ * @returns False if the child failed.
+ */
+static bool run(void (*load)(const std::string&), const std::string& path, double* milliseconds, long* peakMegabytes) {
+	int fds[2];
+	if (pipe(fds) != 0) {
+		return false;
+	}
+	pid_t pid = fork();
+	if (pid == 0) {
+		auto start = std::chrono::steady_clock::now();
+		load(path);
+		double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		ssize_t written = write(fds[1], &elapsed, sizeof(elapsed));
+		_exit(written == sizeof(elapsed) ? 0 : 1);
+	}
+	close(fds[1]);
+	bool isRead = read(fds[0], milliseconds, sizeof(*milliseconds)) == sizeof(*milliseconds);
+	close(fds[0]);
+	int status;
+	struct rusage usage;
+	if (pid < 0 || wait4(pid, &status, 0, &usage) != pid || status != 0 || !isRead) {
+		return false;
+	}
+	*peakMegabytes = usage.ru_maxrss / 1024;
+	return true;
+}
+
+int main(int argc, char** argv) {
+	std::string directory = argc > 1 ? argv[1] : "/tmp";
+	std::string path = directory + "/decode_bench.wav";
+	if (!writeFile(path)) {
+		fprintf(stderr, "could not write %s\n", path.c_str());
+		return 1;
+	}
+
+	printf("%llu frames of stereo s16, best of %d runs\n", (unsigned long long) FRAMES, RUNS);
+	struct {
+		const char* name;
+		void (*load)(const std::string&);
+	} modes[] = {{"before", loadBefore}, {"after", loadAfter}};
+	int result = 0;
+	for (auto& mode : modes) {
+		double best = 1e9;
+		long peak = 0;
+		for (int i = 0; i < RUNS; i++) {
+			double milliseconds;
+			long peakMegabytes;
+			if (!run(mode.load, path, &milliseconds, &peakMegabytes)) {
+				result = 1;
+				break;
+			}
+			best = std::min(best, milliseconds);
+			peak = std::max(peak, peakMegabytes);
+		}
+		printf("%-7s load %7.1f ms  peak RSS %5ld MB\n", mode.name, best, peak);
+	}
+	remove(path.c_str());
+	return result;
+}
@@ -0,0 +1,83 @@
+/**
+ * Cost of fastExp2() against the C library's powf() and exp2f(), and its
+ * error in cents.
+ *
+ * The inputs are pitch voltages from -10 V to 10 V, the range of a 1V/oct
+ * input. Needs the Rack SDK for rack.hpp.
+ */
+#include "FastMath.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+static const int VALUES = 4096;
+static const int REPEATS = 100;
+static const int RUNS = 30;
+// step of the error scan over the input range
+static const double ERROR_STEP = 1e-5;
+
+static float in[VALUES];
+static float out[VALUES];
+
+/**
+ * Time a loop over all inputs.
+ * @param loop Writes out from in.
+ * @returns Nanoseconds per value, best of RUNS.
+ */
+template <typename Loop>
+static double measure(Loop loop) {
+	double best = 1e9;
+	for (int run = 0; run < RUNS; run++) {
+		auto start = std::chrono::steady_clock::now();
+		for (int repeat = 0; repeat < REPEATS; repeat++) {
+			loop();
+			// keep the compiler from dropping unused results
+			__asm__ volatile("" : : "r"(out) : "memory");
+		}
+		double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		best = std::min(best, elapsed / REPEATS / VALUES);
+	}
+	return best;
+}
+
+int main(int argc, char** argv) {
+	for (int i = 0; i < VALUES; i++) {
+		in[i] = -10.f + 20.f * i / VALUES;
+	}
+
+	// the largest error against double precision, and whether the SIMD
+	// version gives the same results as the scalar one
+	double maxCents = 0;
+	bool isSimdSame = true;
+	for (double x = -10; x <= 10; x += ERROR_STEP) {
+		float value = (float) x;
+		float y = fastExp2(value);
+		maxCents = std::max(maxCents, std::fabs(1200 * std::log2(y / std::exp2((double) value))));
+		isSimdSame = isSimdSame && fastExp2(rack::simd::float_4(value))[0] == y;
+	}
+	printf("max error %.4f cents, float_4 %s scalar\n", maxCents, isSimdSame ? "matches" : "differs from");
+
+	printf("powf              %5.2f ns\n", measure([] {
+		for (int i = 0; i < VALUES; i++) {
+			out[i] = powf(2.f, in[i]);
+		}
+	}));
+	printf("exp2f             %5.2f ns\n", measure([] {
+		for (int i = 0; i < VALUES; i++) {
+			out[i] = exp2f(in[i]);
+		}
+	}));
+	printf("fastExp2          %5.2f ns\n", measure([] {
+		for (int i = 0; i < VALUES; i++) {
+			out[i] = fastExp2(in[i]);
+		}
+	}));
+	printf("fastExp2 float_4  %5.2f ns\n", measure([] {
+		for (int i = 0; i < VALUES; i += 4) {
+			fastExp2(rack::simd::float_4::load(&in[i])).store(&out[i]);
+		}
+	}));
+	return isSimdSame ? 0 : 1;
+}
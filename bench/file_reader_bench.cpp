@@ -0,0 +1,139 @@
+/**
+ * Compares the FileReader backends on cold and warm page caches, for the
+ * loader's pattern, one whole-file read, and the streamer's, seeks
+ * followed by short reads.
+ *
+ * For a cold run the file is dropped from the page cache first: its pages
+ * are written back with fdatasync() and dropped with
+ * posix_fadvise(POSIX_FADV_DONTNEED). This needs no root rights, unlike
+ * writing to /proc/sys/vm/drop_caches, and only drops this one file.
+ * Pages mapped by another process stay cached.
+ */
+#include "FileReader.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#define DR_WAV_IMPLEMENTATION
+#include "dr_wav.h"
+
+// 5 minutes of stereo 48 kHz 24-bit audio, 83 MB
+static const drwav_uint64 FRAMES = 48000 * 300;
+static const int SEEKS = 2000;
+static const drwav_uint64 SEEK_READ_SAMPLES = 16384;
+
+static bool writeFile(const std::string& path) {
+	drwav_data_format format;
+	format.container = drwav_container_riff;
+	format.format = DR_WAVE_FORMAT_PCM;
+	format.channels = 2;
+	format.sampleRate = 48000;
+	format.bitsPerSample = 24;
+	drwav* wav = drwav_open_file_write(path.c_str(), &format);
+	if (!wav) {
+		return false;
+	}
+	std::vector<uint8_t> block(65536 * 3);
+	uint32_t seed = 1;
+	for (drwav_uint64 written = 0; written < FRAMES * 2; written += block.size() / 3) {
+		for (uint8_t& byte : block) {
+			seed = seed * 1664525 + 1013904223;
+			byte = seed >> 24;
+		}
+		drwav_write(wav, block.size() / 3, block.data());
+	}
+	drwav_close(wav);
+	return true;
+}
+
+/**
+ * Drop a file from the page cache.
+ * @param path File path.
+ */
+static void dropFromPageCache(const std::string& path) {
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return;
+	}
+	fdatasync(fd);
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	close(fd);
+}
+
+static double since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+	std::string directory = argc > 1 ? argv[1] : "/tmp";
+	std::string path = directory + "/file_reader_bench.wav";
+	if (!writeFile(path)) {
+		fprintf(stderr, "could not write %s\n", path.c_str());
+		return 1;
+	}
+
+	// reference decode through drwav_init_file()
+	drwav wav;
+	drwav_init_file(&wav, path.c_str());
+	std::vector<float> expected(wav.totalSampleCount);
+	std::vector<float> out(wav.totalSampleCount);
+	drwav_uint64 samples = drwav_read_f32(&wav, expected.size(), expected.data());
+	drwav_uninit(&wav);
+
+	printf("%llu samples of stereo s24, %d seeks of %llu samples\n", (unsigned long long) samples, SEEKS, (unsigned long long) SEEK_READ_SAMPLES);
+	int result = 0;
+	for (int b = 0; b < FileReader::NUM_BACKENDS; b++) {
+		FileReader::Backend backend = (FileReader::Backend) b;
+		if (!FileReader::isAvailable(backend)) {
+			printf("%-8s not available\n", FileReader::getBackendName(backend));
+			continue;
+		}
+		const bool isColdRuns[] = {true, false};
+		for (bool isCold : isColdRuns) {
+			// whole file, the loader
+			if (isCold) {
+				dropFromPageCache(path);
+			}
+			auto start = std::chrono::steady_clock::now();
+			bool isSame = FileReader::openWav(path, &wav, backend);
+			if (isSame) {
+				isSame = drwav_read_f32(&wav, samples, out.data()) == samples;
+				FileReader::closeWav(&wav);
+			}
+			double wholeTime = since(start);
+			isSame = isSame && memcmp(out.data(), expected.data(), samples * sizeof(float)) == 0;
+
+			// seeks and short reads, the streamer
+			if (isCold) {
+				dropFromPageCache(path);
+			}
+			start = std::chrono::steady_clock::now();
+			if (FileReader::openWav(path, &wav, backend)) {
+				uint32_t seed = 1;
+				for (int i = 0; i < SEEKS; i++) {
+					seed = seed * 1664525 + 1013904223;
+					drwav_uint64 position = ((drwav_uint64) seed << 8) % (samples - SEEK_READ_SAMPLES) & ~(drwav_uint64) 1;
+					drwav_seek_to_sample(&wav, position);
+					drwav_uint64 read = drwav_read_f32(&wav, SEEK_READ_SAMPLES, out.data());
+					if (read != SEEK_READ_SAMPLES || memcmp(out.data(), &expected[position], read * sizeof(float)) != 0) {
+						isSame = false;
+					}
+				}
+				FileReader::closeWav(&wav);
+			} else {
+				isSame = false;
+			}
+			double seekTime = since(start);
+
+			printf("%-8s %-4s  whole file %7.1f ms  seeks %7.1f ms  %s\n", FileReader::getBackendName(backend), isCold ? "cold" : "warm",
+				wholeTime, seekTime, isSame ? "same output" : "DIFFERENT OUTPUT");
+			result |= isSame ? 0 : 1;
+		}
+	}
+	remove(path.c_str());
+	return result;
+}
@@ -0,0 +1,113 @@
+/**
+ * Throughput of drwav_read_f32() for 8, 16, 24 and 32-bit PCM and 32 and
+ * 64-bit float files, with the number of read callbacks it makes.
+ *
+ * Each file is 16M samples of stereo noise, read in one call from the page
+ * cache, so the time is the decode path and not the disk.
+ */
+#define DR_WAV_IMPLEMENTATION
+#include "dr_wav.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static const size_t SAMPLES = size_t(16) << 20;
+static const int RUNS = 5;
+
+struct Format {
+	const char* name;
+	drwav_uint32 format;
+	drwav_uint32 bitsPerSample;
+};
+
+static const Format FORMATS[] = {
+	{"u8", DR_WAVE_FORMAT_PCM, 8},
+	{"s16", DR_WAVE_FORMAT_PCM, 16},
+	{"s24", DR_WAVE_FORMAT_PCM, 24},
+	{"s32", DR_WAVE_FORMAT_PCM, 32},
+	{"f32", DR_WAVE_FORMAT_IEEE_FLOAT, 32},
+	{"f64", DR_WAVE_FORMAT_IEEE_FLOAT, 64},
+};
+
+static long readCalls = 0;
+
+static size_t onRead(void* userData, void* buffer, size_t bytesToRead) {
+	readCalls++;
+	return fread(buffer, 1, bytesToRead, (FILE*) userData);
+}
+
+static drwav_bool32 onSeek(void* userData, int offset, drwav_seek_origin origin) {
+	return fseek((FILE*) userData, offset, origin == drwav_seek_origin_current ? SEEK_CUR : SEEK_SET) == 0;
+}
+
+static bool writeFile(const std::string& path, const Format& format) {
+	drwav_data_format dataFormat;
+	dataFormat.container = drwav_container_riff;
+	dataFormat.format = format.format;
+	dataFormat.channels = 2;
+	dataFormat.sampleRate = 48000;
+	dataFormat.bitsPerSample = format.bitsPerSample;
+	drwav* wav = drwav_open_file_write(path.c_str(), &dataFormat);
+	if (!wav) {
+		return false;
+	}
+
+	// float files get samples in [-1, 1), PCM files random bytes
+	std::vector<unsigned char> raw(SAMPLES * format.bitsPerSample / 8);
+	uint32_t seed = 1;
+	for (size_t i = 0; i < SAMPLES; i++) {
+		seed = seed * 1664525 + 1013904223;
+		float sample = (seed >> 8) / 8388608.f - 1.f;
+		if (format.format == DR_WAVE_FORMAT_IEEE_FLOAT && format.bitsPerSample == 32) {
+			reinterpret_cast<float*>(raw.data())[i] = sample;
+		} else if (format.format == DR_WAVE_FORMAT_IEEE_FLOAT) {
+			reinterpret_cast<double*>(raw.data())[i] = sample;
+		} else {
+			for (size_t byte = 0; byte < format.bitsPerSample / 8; byte++) {
+				raw[i * format.bitsPerSample / 8 + byte] = seed >> (8 * byte);
+			}
+		}
+	}
+	drwav_write(wav, SAMPLES, raw.data());
+	drwav_close(wav);
+	return true;
+}
+
+int main(int argc, char** argv) {
+	std::string directory = argc > 1 ? argv[1] : "/tmp";
+	std::vector<float> out(SAMPLES);
+	int result = 0;
+
+	printf("%zu samples per file, best of %d runs\n", SAMPLES, RUNS);
+	for (const Format& format : FORMATS) {
+		std::string path = directory + "/read_pcm_bench_" + format.name + ".wav";
+		if (!writeFile(path, format)) {
+			fprintf(stderr, "could not write %s\n", path.c_str());
+			return 1;
+		}
+
+		double best = 1e9;
+		for (int run = 0; run < RUNS; run++) {
+			FILE* file = fopen(path.c_str(), "rb");
+			drwav wav;
+			if (!file || !drwav_init(&wav, onRead, onSeek, file)) {
+				result = 1;
+				break;
+			}
+			readCalls = 0;
+			auto start = std::chrono::steady_clock::now();
+			drwav_uint64 read = drwav_read_f32(&wav, SAMPLES, out.data());
+			best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+			drwav_uninit(&wav);
+			fclose(file);
+			if (read != SAMPLES) {
+				result = 1;
+			}
+		}
+		remove(path.c_str());
+		printf("%-4s %7.1f ms  %6.0f Msamples/s  %6ld read calls\n", format.name, best, SAMPLES / best / 1000, readCalls);
+	}
+	return result;
+}
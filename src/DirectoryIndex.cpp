@@ -0,0 +1,265 @@
+#include "DirectoryIndex.hpp"
+#include <algorithm>
+#include <cctype>
+#include <dirent.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+// directory changes that affect a listing
+static const uint32_t WATCH_EVENTS = IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+#endif
+
+static bool compareNames(const WavFileInfo& info, const std::string& name) {
+	return info.name < name;
+}
+
+/**
+ * Find a file name in the listing with a binary search.
+ * @param name File name without directory.
+ * @returns Position in the listing, -1 if the file is not listed.
+ */
+int DirectoryListing::find(const std::string& name) const {
+	auto it = std::lower_bound(files.begin(), files.end(), name, compareNames);
+	if (it == files.end() || it->name != name) {
+		return -1;
+	}
+	return it - files.begin();
+}
+
+DirectoryIndex::DirectoryIndex() {
+	isExiting = false;
+}
+
+/**
+ * Stops the watcher thread.
+ */
+DirectoryIndex::~DirectoryIndex() {
+	isExiting = true;
+	if (watcherThread.joinable()) {
+		watcherThread.join();
+	}
+#ifdef __linux__
+	if (notifyFd >= 0) {
+		close(notifyFd);
+	}
+#endif
+}
+
+/**
+ * The index shared by all modules of the plugin.
+ * @returns The global index.
+ */
+DirectoryIndex& DirectoryIndex::global() {
+	static DirectoryIndex index;
+	return index;
+}
+
+/**
+ * Get the listing of a directory.
+ * Scans the directory the first time, and again if it is not watched and
+ * its modification time changed.
+ * @param path Directory path.
+ * @returns The listing, or NULL if the directory could not be read.
+ */
+std::shared_ptr<const DirectoryListing> DirectoryIndex::get(std::string path) {
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0) {
+		return NULL;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = entries.find(path);
+	if (it != entries.end() && (it->second.watch >= 0 || it->second.modified == info.st_mtime)) {
+		return it->second.listing;
+	}
+
+	// watch before scanning, so no change gets lost in between
+	Entry entry;
+	entry.watch = watch(path);
+	entry.modified = info.st_mtime;
+	entry.listing = scan(path);
+	if (!entry.listing) {
+		return NULL;
+	}
+	entries[path] = entry;
+	return entry.listing;
+}
+
+/**
+ * Check for a .wav extension in any case.
+ * @param name File name.
+ * @returns True for Wav files.
+ */
+bool DirectoryIndex::isWavFileName(const std::string& name) {
+	if (name.length() < 5) {
+		return false;
+	}
+	const char* extension = name.c_str() + name.length() - 4;
+	return extension[0] == '.' &&
+		std::tolower(extension[1]) == 'w' &&
+		std::tolower(extension[2]) == 'a' &&
+		std::tolower(extension[3]) == 'v';
+}
+
+/**
+ * Read the format of a Wav file without decoding any audio.
+ * @param path File path.
+ * @param info Receives channels, sample rate and length.
+ * @returns True if the file is a Wav file dr_wav can play.
+ */
+bool DirectoryIndex::readHeader(const std::string& path, WavFileInfo* info) {
+	drwav wav;
+	if (!drwav_init_file(&wav, path.c_str())) {
+		return false;
+	}
+	info->channels = wav.channels;
+	info->sampleRate = wav.sampleRate;
+	info->totalSampleCount = wav.totalSampleCount;
+	drwav_uninit(&wav);
+	return info->totalSampleCount > 0;
+}
+
+/**
+ * List the Wav files in a directory.
+ * Files that can't be played are left out.
+ * @param path Directory path.
+ * @returns The listing, or NULL if the directory could not be read.
+ */
+std::shared_ptr<const DirectoryListing> DirectoryIndex::scan(const std::string& path) {
+	DIR* directory = opendir(path.c_str());
+	if (!directory) {
+		return NULL;
+	}
+
+	std::shared_ptr<DirectoryListing> listing = std::make_shared<DirectoryListing>();
+	listing->path = path;
+	struct dirent* directoryEntry;
+	while ((directoryEntry = readdir(directory)) != NULL) {
+		WavFileInfo info;
+		info.name = directoryEntry->d_name;
+		if (isWavFileName(info.name) && readHeader(path + "/" + info.name, &info)) {
+			listing->files.push_back(info);
+		}
+	}
+	closedir(directory);
+
+	// readdir order is arbitrary
+	std::sort(listing->files.begin(), listing->files.end(), [](const WavFileInfo& a, const WavFileInfo& b) {
+		return a.name < b.name;
+	});
+	return listing;
+}
+
+/**
+ * Start watching a directory for changes.
+ * Called with the mutex held. Starts the watcher thread on first use.
+ * @param path Directory path.
+ * @returns Watch descriptor, -1 if the directory can't be watched.
+ */
+int DirectoryIndex::watch(const std::string& path) {
+#ifdef __linux__
+	if (notifyFd < 0) {
+		notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (notifyFd < 0) {
+			return -1;
+		}
+		watcherThread = std::thread(&DirectoryIndex::runWatcher, this);
+	}
+
+	// watching a directory again returns the same descriptor
+	int wd = inotify_add_watch(notifyFd, path.c_str(), WATCH_EVENTS);
+	if (wd >= 0) {
+		watches[wd] = path;
+	}
+	return wd;
+#else
+	return -1;
+#endif
+}
+
+/**
+ * Bring a listing up to date with a change to one file.
+ * Runs on the watcher thread. The header is read before taking the mutex.
+ * @param path Directory path.
+ * @param name File name.
+ * @param isRemoved True if the file left the directory.
+ */
+void DirectoryIndex::updateFile(const std::string& path, const std::string& name, bool isRemoved) {
+	WavFileInfo info;
+	info.name = name;
+	bool isListed = !isRemoved && readHeader(path + "/" + name, &info);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = entries.find(path);
+	if (it == entries.end()) {
+		return;
+	}
+
+	std::shared_ptr<DirectoryListing> listing = std::make_shared<DirectoryListing>(*it->second.listing);
+	auto file = std::lower_bound(listing->files.begin(), listing->files.end(), name, compareNames);
+	if (file != listing->files.end() && file->name == name) {
+		file = listing->files.erase(file);
+	}
+	if (isListed) {
+		listing->files.insert(file, info);
+	}
+	it->second.listing = listing;
+}
+
+/**
+ * Watcher thread main loop, applies inotify events to the listings.
+ */
+void DirectoryIndex::runWatcher() {
+#ifdef __linux__
+	alignas(struct inotify_event) char buffer[4096];
+	while (!isExiting) {
+		struct pollfd pollFd = {notifyFd, POLLIN, 0};
+		if (poll(&pollFd, 1, 100) <= 0) {
+			continue;
+		}
+
+		ssize_t length = read(notifyFd, buffer, sizeof(buffer));
+		for (ssize_t offset = 0; offset < length;) {
+			const struct inotify_event* event = (const struct inotify_event*) (buffer + offset);
+			offset += sizeof(struct inotify_event) + event->len;
+
+			// too many changes at once, scan everything again on the next get()
+			if (event->mask & IN_Q_OVERFLOW) {
+				std::lock_guard<std::mutex> lock(mutex);
+				entries.clear();
+				continue;
+			}
+
+			std::string path;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				auto it = watches.find(event->wd);
+				if (it == watches.end()) {
+					continue;
+				}
+				path = it->second;
+
+				// the directory itself is gone or moved
+				if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+					if (!(event->mask & IN_IGNORED)) {
+						inotify_rm_watch(notifyFd, event->wd);
+					}
+					watches.erase(it);
+					entries.erase(path);
+					continue;
+				}
+			}
+
+			std::string name = event->len > 0 ? event->name : "";
+			if (isWavFileName(name)) {
+				updateFile(path, name, (event->mask & (IN_DELETE | IN_MOVED_FROM)) != 0);
+			}
+		}
+	}
+#endif
+}
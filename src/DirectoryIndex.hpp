@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "dr_wav.h"
+
+/**
+ * A Wav file in a directory listing, with the format read from its header.
+ */
+struct WavFileInfo {
+	std::string name;
+	unsigned int channels = 0;
+	unsigned int sampleRate = 0;
+	drwav_uint64 totalSampleCount = 0;
+};
+
+/**
+ * The Wav files in a directory, sorted by name.
+ * Immutable, a change to the directory produces a new listing.
+ */
+struct DirectoryListing {
+	std::string path;
+	std::vector<WavFileInfo> files;
+
+	// position of a file name in the listing, -1 if it is not listed
+	int find(const std::string& name) const;
+
+	// full path of the file at a position in the listing
+	std::string getPath(int index) const {
+		return path + "/" + files[index].name;
+	}
+};
+
+/**
+ * Process wide cache of directory listings.
+ *
+ * A directory is scanned once, reading only the headers of its Wav files.
+ * On Linux the listings are kept current with inotify, a change to one file
+ * only reads that file's header again. Elsewhere, or when a directory can't
+ * be watched, a listing is scanned again when the directory's modification
+ * time changes.
+ */
+struct DirectoryIndex {
+
+	// the index shared by all modules of the plugin
+	static DirectoryIndex& global();
+
+	// get the listing of a directory, scanning it if it is not indexed yet
+	std::shared_ptr<const DirectoryListing> get(std::string path);
+
+	~DirectoryIndex();
+
+private:
+
+	struct Entry {
+		std::shared_ptr<const DirectoryListing> listing;
+		// inotify watch descriptor, -1 when not watched
+		int watch = -1;
+		time_t modified = 0;
+	};
+
+	std::mutex mutex;
+	std::map<std::string, Entry> entries;
+	// directory of each inotify watch descriptor
+	std::map<int, std::string> watches;
+
+	// inotify instance and the thread reading its events
+	int notifyFd = -1;
+	std::thread watcherThread;
+	std::atomic<bool> isExiting;
+
+	DirectoryIndex();
+	static bool isWavFileName(const std::string& name);
+	static bool readHeader(const std::string& path, WavFileInfo* info);
+	static std::shared_ptr<const DirectoryListing> scan(const std::string& path);
+	int watch(const std::string& path);
+	void updateFile(const std::string& path, const std::string& name, bool isRemoved);
+	void runWatcher();
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <rack.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Approximations of math functions for the audio thread.
+ */
+
+// minimax polynomial for 2^f on [-0.5, 0.5], relative error 2.6e-6
+static const float EXP2_C0 = 0.999999261445712079731f;
+static const float EXP2_C1 = 0.693121814736689565838f;
+static const float EXP2_C2 = 0.240247448278639704736f;
+static const float EXP2_C3 = 0.0559178603193863514732f;
+static const float EXP2_C4 = 0.00957010191115816922622f;
+// adding 1.5 * 2^23 leaves x rounded to an integer in the low mantissa bits
+static const float EXP2_ROUND = 12582912.f;
+static const int32_t EXP2_ROUND_BITS = 0x4b400000;
+
+/**
+ * 2^x for 1V/oct pitch.
+ * x is split into the nearest integer and a fraction in [-0.5, 0.5]. The
+ * fraction goes through a polynomial, the integer is added to the exponent
+ * bits of the result. Off by at most 0.005 cents, x is clamped to [-125, 125].
+ * @param x Exponent, for example a pitch voltage.
+ * @returns 2^x.
+ */
+inline float fastExp2(float x) {
+	x = std::min(std::max(x, -125.f), 125.f);
+	float rounded = x + EXP2_ROUND;
+	int32_t i;
+	std::memcpy(&i, &rounded, sizeof(i));
+	i -= EXP2_ROUND_BITS;
+	float f = x - (float) i;
+	float y = (((EXP2_C4 * f + EXP2_C3) * f + EXP2_C2) * f + EXP2_C1) * f + EXP2_C0;
+
+	// scaling by 2^i is adding i to the exponent, shifted unsigned as i may be negative
+	int32_t bits;
+	std::memcpy(&bits, &y, sizeof(bits));
+	bits += (int32_t) ((uint32_t) i << 23);
+	std::memcpy(&y, &bits, sizeof(y));
+	return y;
+}
+
+/**
+ * 2^x of four values, the same results as the scalar fastExp2().
+ * @param x Exponents.
+ * @returns 2^x.
+ */
+inline rack::simd::float_4 fastExp2(rack::simd::float_4 x) {
+	__m128 v = _mm_min_ps(_mm_max_ps(x.v, _mm_set1_ps(-125.f)), _mm_set1_ps(125.f));
+	__m128i i = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(v, _mm_set1_ps(EXP2_ROUND))), _mm_set1_epi32(EXP2_ROUND_BITS));
+	__m128 f = _mm_sub_ps(v, _mm_cvtepi32_ps(i));
+
+	__m128 y = _mm_set1_ps(EXP2_C4);
+	y = _mm_add_ps(_mm_mul_ps(y, f), _mm_set1_ps(EXP2_C3));
+	y = _mm_add_ps(_mm_mul_ps(y, f), _mm_set1_ps(EXP2_C2));
+	y = _mm_add_ps(_mm_mul_ps(y, f), _mm_set1_ps(EXP2_C1));
+	y = _mm_add_ps(_mm_mul_ps(y, f), _mm_set1_ps(EXP2_C0));
+	return rack::simd::float_4(_mm_castsi128_ps(_mm_add_epi32(_mm_castps_si128(y), _mm_slli_epi32(i, 23))));
+}
@@ -0,0 +1,603 @@
+#include "FileReader.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#if !defined ARCH_WIN
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined __linux__ && defined __has_include
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define FILE_READER_IO_URING
+#endif
+#endif
+
+// block size after a seek, doubled with every sequential block read
+static const size_t MIN_BLOCK_SIZE = size_t(64) << 10;
+// largest block of the pread backend
+static const size_t PREAD_BLOCK_SIZE = size_t(1) << 20;
+// how far ahead of the read position the pread backend asks the kernel to read
+static const uint64_t ADVISE_WINDOW = uint64_t(8) << 20;
+// largest block and most blocks in flight of the io_uring backend
+static const size_t URING_BLOCK_SIZE = size_t(512) << 10;
+static const unsigned int URING_DEPTH = 8;
+
+std::atomic<int> FileReader::backend(FileReader::BACKEND_STDIO);
+
+/**
+ * Buffered stdio reads, the same as drwav_init_file().
+ */
+struct StdioReader : FileReader {
+	FILE* file = NULL;
+
+	~StdioReader() {
+		if (file) {
+			fclose(file);
+		}
+	}
+
+	bool open(const std::string& path) {
+		file = fopen(path.c_str(), "rb");
+		return file != NULL;
+	}
+
+	size_t read(void* buffer, size_t size) override {
+		return fread(buffer, 1, size, file);
+	}
+
+	bool seek(uint64_t pos) override {
+#if defined ARCH_WIN
+		return _fseeki64(file, pos, SEEK_SET) == 0;
+#else
+		return fseeko(file, pos, SEEK_SET) == 0;
+#endif
+	}
+
+	uint64_t tell() override {
+#if defined ARCH_WIN
+		return _ftelli64(file);
+#else
+		return ftello(file);
+#endif
+	}
+};
+
+#if !defined ARCH_WIN
+
+/**
+ * Large block pread() calls on an unbuffered file descriptor.
+ * Blocks start small after a seek and grow while the file is read
+ * sequentially, reads that span a whole block go straight to the caller's
+ * buffer. Sequential reads also ask the kernel to read a window ahead of
+ * the read position.
+ */
+struct PreadReader : FileReader {
+	int fd = -1;
+	uint64_t pos = 0;
+	std::vector<uint8_t> block;
+	uint64_t blockPos = 0;
+	size_t blockLength = 0;
+	size_t blockSize = MIN_BLOCK_SIZE;
+	uint64_t advisedStart = 0;
+	uint64_t advisedEnd = 0;
+
+	~PreadReader() {
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+
+	bool open(const std::string& path) {
+		fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			return false;
+		}
+#ifdef POSIX_FADV_SEQUENTIAL
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+		block.resize(PREAD_BLOCK_SIZE);
+		return true;
+	}
+
+	/**
+	 * Ask the kernel to read ahead when the read position gets close to the
+	 * end of the window asked for last time, or leaves it.
+	 */
+	void advise() {
+#ifdef POSIX_FADV_WILLNEED
+		bool isInWindow = pos >= advisedStart && pos < advisedEnd;
+		if (isInWindow && pos + ADVISE_WINDOW / 2 < advisedEnd) {
+			return;
+		}
+		uint64_t start = isInWindow ? advisedEnd : pos;
+		posix_fadvise(fd, start, pos + ADVISE_WINDOW - start, POSIX_FADV_WILLNEED);
+		advisedStart = pos;
+		advisedEnd = pos + ADVISE_WINDOW;
+#endif
+	}
+
+	size_t read(void* buffer, size_t size) override {
+		uint8_t* out = static_cast<uint8_t*>(buffer);
+		size_t done = 0;
+		while (done < size) {
+			if (pos >= blockPos && pos < blockPos + blockLength) {
+				size_t n = std::min<uint64_t>(size - done, blockPos + blockLength - pos);
+				std::memcpy(out + done, &block[pos - blockPos], n);
+				pos += n;
+				done += n;
+				continue;
+			}
+
+			if (pos == blockPos + blockLength) {
+				blockSize = std::min(2 * blockSize, PREAD_BLOCK_SIZE);
+				advise();
+			} else {
+				blockSize = MIN_BLOCK_SIZE;
+			}
+			bool isDirect = size - done >= blockSize;
+			ssize_t n = isDirect ? pread(fd, out + done, size - done, pos) : pread(fd, block.data(), blockSize, pos);
+			if (n < 0 && errno == EINTR) {
+				continue;
+			}
+			if (n <= 0) {
+				break;
+			}
+			if (isDirect) {
+				pos += n;
+				done += n;
+				blockPos = pos;
+				blockLength = 0;
+			} else {
+				blockPos = pos;
+				blockLength = n;
+			}
+		}
+		return done;
+	}
+
+	bool seek(uint64_t newPos) override {
+		pos = newPos;
+		return true;
+	}
+
+	uint64_t tell() override {
+		return pos;
+	}
+};
+
+#endif
+
+#ifdef FILE_READER_IO_URING
+
+static int ioUringSetup(unsigned int entries, struct io_uring_params* params) {
+	return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int ioUringEnter(int ringFd, unsigned int toSubmit, unsigned int minComplete, unsigned int flags) {
+	return syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, NULL, 0);
+}
+
+/**
+ * Asynchronous reads through io_uring, without liburing.
+ * Keeps a queue of consecutive blocks in flight ahead of the read position.
+ * A read that is not in the block at the head of the queue, after a seek or
+ * a short read, waits for the reads in flight and starts a new queue from
+ * there. A new queue holds one small block, every block used up adds a
+ * block and doubles the block size, up to URING_DEPTH blocks of
+ * URING_BLOCK_SIZE.
+ */
+struct UringReader : FileReader {
+
+	struct Slot {
+		std::vector<uint8_t> data;
+		struct iovec iov;
+		uint64_t offset = 0;
+		size_t requested = 0;
+		// bytes read, or a negative error code
+		int result = 0;
+		bool isQueued = false;
+		bool isPending = false;
+	};
+
+	int fd = -1;
+	uint64_t fileSize = 0;
+	uint64_t pos = 0;
+	Slot slots[URING_DEPTH];
+	// slot of the oldest queued block
+	unsigned int head = 0;
+	unsigned int queued = 0;
+	unsigned int depth = 1;
+	// file offset and size of the next block to queue
+	uint64_t nextOffset = 0;
+	size_t blockSize = MIN_BLOCK_SIZE;
+	unsigned int toSubmit = 0;
+	unsigned int inFlight = 0;
+	bool isBroken = false;
+
+	int ringFd = -1;
+	void* sqRing = MAP_FAILED;
+	size_t sqRingSize = 0;
+	void* cqRing = MAP_FAILED;
+	size_t cqRingSize = 0;
+	struct io_uring_sqe* sqes = (struct io_uring_sqe*) MAP_FAILED;
+	size_t sqesSize = 0;
+	unsigned int* sqTail = NULL;
+	unsigned int* sqMask = NULL;
+	unsigned int* sqArray = NULL;
+	unsigned int* cqHead = NULL;
+	unsigned int* cqTail = NULL;
+	unsigned int* cqMask = NULL;
+	struct io_uring_cqe* cqes = NULL;
+
+	/**
+	 * Waits for the reads in flight, the kernel writes into the slots.
+	 */
+	~UringReader() {
+		drain();
+		if (sqes != MAP_FAILED) {
+			munmap(sqes, sqesSize);
+		}
+		if (cqRing != MAP_FAILED) {
+			munmap(cqRing, cqRingSize);
+		}
+		if (sqRing != MAP_FAILED) {
+			munmap(sqRing, sqRingSize);
+		}
+		if (ringFd >= 0) {
+			close(ringFd);
+		}
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+
+	/**
+	 * Open the file and set up the ring.
+	 * @param path File path.
+	 * @returns False if the file can't be opened or io_uring is not available.
+	 */
+	bool open(const std::string& path) {
+		fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		struct stat fileStat;
+		if (fd < 0 || fstat(fd, &fileStat) != 0) {
+			return false;
+		}
+		fileSize = fileStat.st_size;
+
+		struct io_uring_params params;
+		std::memset(&params, 0, sizeof(params));
+		ringFd = ioUringSetup(URING_DEPTH, &params);
+		if (ringFd < 0) {
+			return false;
+		}
+		sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+		cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+		sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+		sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+		cqRing = mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+		sqes = (struct io_uring_sqe*) mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+		if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == MAP_FAILED) {
+			return false;
+		}
+
+		uint8_t* sq = static_cast<uint8_t*>(sqRing);
+		uint8_t* cq = static_cast<uint8_t*>(cqRing);
+		sqTail = (unsigned int*) (sq + params.sq_off.tail);
+		sqMask = (unsigned int*) (sq + params.sq_off.ring_mask);
+		sqArray = (unsigned int*) (sq + params.sq_off.array);
+		cqHead = (unsigned int*) (cq + params.cq_off.head);
+		cqTail = (unsigned int*) (cq + params.cq_off.tail);
+		cqMask = (unsigned int*) (cq + params.cq_off.ring_mask);
+		cqes = (struct io_uring_cqe*) (cq + params.cq_off.cqes);
+
+		for (Slot& slot : slots) {
+			slot.data.resize(URING_BLOCK_SIZE);
+		}
+		return true;
+	}
+
+	/**
+	 * Put the reads of the next blocks on the submission queue, up to the
+	 * current depth.
+	 */
+	void queue() {
+		while (queued < depth && nextOffset < fileSize) {
+			unsigned int index = (head + queued) % URING_DEPTH;
+			Slot& slot = slots[index];
+			slot.offset = nextOffset;
+			slot.requested = std::min<uint64_t>(blockSize, fileSize - nextOffset);
+			slot.iov.iov_base = slot.data.data();
+			slot.iov.iov_len = slot.requested;
+			slot.isQueued = true;
+			slot.isPending = true;
+			nextOffset += slot.requested;
+			blockSize = std::min(2 * blockSize, URING_BLOCK_SIZE);
+			queued++;
+
+			unsigned int tail = *sqTail;
+			unsigned int entry = tail & *sqMask;
+			struct io_uring_sqe* sqe = &sqes[entry];
+			std::memset(sqe, 0, sizeof(*sqe));
+			sqe->opcode = IORING_OP_READV;
+			sqe->fd = fd;
+			sqe->addr = (uint64_t) (uintptr_t) &slot.iov;
+			sqe->len = 1;
+			sqe->off = slot.offset;
+			sqe->user_data = index;
+			sqArray[entry] = entry;
+			__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+			toSubmit++;
+		}
+	}
+
+	/**
+	 * Hand the queued reads to the kernel.
+	 */
+	void submit() {
+		while (toSubmit > 0 && !isBroken) {
+			int submitted = ioUringEnter(ringFd, toSubmit, 0, 0);
+			if (submitted < 0 && errno == EINTR) {
+				continue;
+			}
+			if (submitted <= 0) {
+				isBroken = true;
+				break;
+			}
+			toSubmit -= submitted;
+			inFlight += submitted;
+		}
+	}
+
+	/**
+	 * Wait for at least one read to complete and collect all completed reads.
+	 * @returns False if waiting failed.
+	 */
+	bool wait() {
+		if (ioUringEnter(ringFd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+			isBroken = true;
+			return false;
+		}
+		unsigned int cqHeadValue = *cqHead;
+		unsigned int cqTailValue = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+		for (; cqHeadValue != cqTailValue; cqHeadValue++) {
+			const struct io_uring_cqe* cqe = &cqes[cqHeadValue & *cqMask];
+			Slot& slot = slots[cqe->user_data];
+			slot.result = cqe->res;
+			slot.isPending = false;
+			inFlight--;
+		}
+		__atomic_store_n(cqHead, cqHeadValue, __ATOMIC_RELEASE);
+		return true;
+	}
+
+	/**
+	 * Wait for all reads in flight.
+	 */
+	void drain() {
+		while (inFlight > 0 && wait()) {
+		}
+	}
+
+	/**
+	 * Drop the queue and queue blocks from the read position.
+	 */
+	void restart() {
+		drain();
+		for (Slot& slot : slots) {
+			slot.isQueued = false;
+		}
+		head = 0;
+		queued = 0;
+		depth = 1;
+		nextOffset = pos;
+		blockSize = MIN_BLOCK_SIZE;
+		queue();
+		submit();
+	}
+
+	size_t read(void* buffer, size_t size) override {
+		uint8_t* out = static_cast<uint8_t*>(buffer);
+		size_t done = 0;
+		while (done < size && pos < fileSize && !isBroken) {
+			Slot& slot = slots[head];
+			if (!slot.isQueued || pos < slot.offset || pos >= slot.offset + slot.requested) {
+				restart();
+				continue;
+			}
+			while (slot.isPending && wait()) {
+			}
+			if (slot.isPending || slot.result <= 0) {
+				break;
+			}
+
+			// a short read leaves the rest of the block to a new queue
+			if (pos >= slot.offset + slot.result) {
+				restart();
+				continue;
+			}
+
+			size_t n = std::min<uint64_t>(size - done, slot.offset + slot.result - pos);
+			std::memcpy(out + done, &slot.data[pos - slot.offset], n);
+			pos += n;
+			done += n;
+
+			// the block is used up, queue the next ones
+			if (pos == slot.offset + slot.requested) {
+				slot.isQueued = false;
+				head = (head + 1) % URING_DEPTH;
+				queued--;
+				depth = std::min(depth + 1, URING_DEPTH);
+				queue();
+				submit();
+			}
+		}
+		return done;
+	}
+
+	bool seek(uint64_t newPos) override {
+		pos = newPos;
+		return true;
+	}
+
+	uint64_t tell() override {
+		return pos;
+	}
+};
+
+#endif
+
+/**
+ * Name of a backend, as shown in the menu and stored in the settings.
+ * @param backend The backend.
+ * @returns The name.
+ */
+const char* FileReader::getBackendName(Backend backend) {
+	switch (backend) {
+		case BACKEND_PREAD:
+			return "pread";
+		case BACKEND_IO_URING:
+			return "io_uring";
+		case BACKEND_STDIO:
+		default:
+			return "stdio";
+	}
+}
+
+/**
+ * Check whether a backend can be used on this system.
+ * io_uring can be missing from the kernel or blocked by a sandbox, so a
+ * ring is set up once to find out.
+ * @param backend The backend.
+ * @returns True if files opened with the backend don't fall back to another.
+ */
+bool FileReader::isAvailable(Backend backend) {
+	switch (backend) {
+		case BACKEND_STDIO:
+			return true;
+		case BACKEND_PREAD:
+#if defined ARCH_WIN
+			return false;
+#else
+			return true;
+#endif
+		case BACKEND_IO_URING: {
+#ifdef FILE_READER_IO_URING
+			static bool isUringAvailable = [] {
+				struct io_uring_params params;
+				std::memset(&params, 0, sizeof(params));
+				int ringFd = ioUringSetup(1, &params);
+				if (ringFd < 0) {
+					return false;
+				}
+				close(ringFd);
+				return true;
+			}();
+			return isUringAvailable;
+#else
+			return false;
+#endif
+		}
+		default:
+			return false;
+	}
+}
+
+/**
+ * Open a file for reading.
+ * A backend that isn't available falls back to pread, then to stdio.
+ * @param path File path.
+ * @param backend The backend to read with.
+ * @returns The reader, or NULL if the file can't be opened.
+ */
+FileReader* FileReader::open(const std::string& path, Backend backend) {
+#ifdef FILE_READER_IO_URING
+	if (backend == BACKEND_IO_URING) {
+		UringReader* reader = new UringReader();
+		if (reader->open(path)) {
+			return reader;
+		}
+		delete reader;
+		backend = BACKEND_PREAD;
+	}
+#endif
+#if !defined ARCH_WIN
+	if (backend == BACKEND_PREAD || backend == BACKEND_IO_URING) {
+		PreadReader* reader = new PreadReader();
+		if (reader->open(path)) {
+			return reader;
+		}
+		delete reader;
+		return NULL;
+	}
+#endif
+	StdioReader* reader = new StdioReader();
+	if (reader->open(path)) {
+		return reader;
+	}
+	delete reader;
+	return NULL;
+}
+
+static size_t onRead(void* userData, void* buffer, size_t size) {
+	return static_cast<FileReader*>(userData)->read(buffer, size);
+}
+
+static drwav_bool32 onSeek(void* userData, int offset, drwav_seek_origin origin) {
+	FileReader* reader = static_cast<FileReader*>(userData);
+	int64_t pos = offset;
+	if (origin == drwav_seek_origin_current) {
+		pos += reader->tell();
+	}
+	return pos >= 0 && reader->seek(pos);
+}
+
+static drwav_bool32 onSeek64(void* userData, drwav_uint64 position) {
+	return static_cast<FileReader*>(userData)->seek(position);
+}
+
+/**
+ * Open a Wav file with the backend selected in the settings.
+ * @param path File path.
+ * @param wav The Wav file to initialize, close it with closeWav().
+ * @returns False if the file can't be opened or is not a Wav file.
+ */
+bool FileReader::openWav(const std::string& path, drwav* wav) {
+	return openWav(path, wav, getBackend());
+}
+
+/**
+ * Open a Wav file with a backend.
+ * @param path File path.
+ * @param wav The Wav file to initialize, close it with closeWav().
+ * @param backend The backend to read with.
+ * @returns False if the file can't be opened or is not a Wav file.
+ */
+bool FileReader::openWav(const std::string& path, drwav* wav, Backend backend) {
+	FileReader* reader = open(path, backend);
+	if (!reader) {
+		return false;
+	}
+	if (!drwav_init(wav, onRead, onSeek, reader)) {
+		delete reader;
+		return false;
+	}
+	wav->onSeek64 = onSeek64;
+	return true;
+}
+
+/**
+ * Close a Wav file opened with openWav().
+ * @param wav The Wav file.
+ */
+void FileReader::closeWav(drwav* wav) {
+	FileReader* reader = static_cast<FileReader*>(wav->pUserData);
+	drwav_uninit(wav);
+	delete reader;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "dr_wav.h"
+
+/**
+ * Reads a file for dr_wav through one of several I/O backends.
+ *
+ * The loader and the streamer open their Wav files with openWav(), which
+ * picks the backend selected in the plugin settings:
+ * - stdio: buffered FILE reads, like drwav_init_file()
+ * - pread: large block reads with posix_fadvise() read ahead hints
+ * - io_uring: a queue of asynchronous block reads kept in flight ahead of
+ *   the read position (Linux only)
+ * A backend that isn't available on this system falls back to the next
+ * simpler one.
+ */
+struct FileReader {
+
+	enum Backend {
+		BACKEND_STDIO,
+		BACKEND_PREAD,
+		BACKEND_IO_URING,
+		NUM_BACKENDS
+	};
+
+	// backend used for files opened from now on
+	static Backend getBackend() {
+		return static_cast<Backend>(backend.load(std::memory_order_relaxed));
+	}
+	static void setBackend(Backend newBackend) {
+		backend.store(newBackend, std::memory_order_relaxed);
+	}
+
+	// name of a backend, as shown in the menu and stored in the settings
+	static const char* getBackendName(Backend backend);
+
+	// true if a backend can be used on this system
+	static bool isAvailable(Backend backend);
+
+	// open a file with a backend, NULL if it can't be opened
+	static FileReader* open(const std::string& path, Backend backend);
+
+	// open a Wav file with the selected backend, close it with closeWav()
+	static bool openWav(const std::string& path, drwav* wav);
+	static bool openWav(const std::string& path, drwav* wav, Backend backend);
+	static void closeWav(drwav* wav);
+
+	virtual ~FileReader() {}
+
+	// read from the current position, returns the number of bytes read
+	virtual size_t read(void* buffer, size_t size) = 0;
+
+	// move to an absolute position
+	virtual bool seek(uint64_t pos) = 0;
+
+	// current position
+	virtual uint64_t tell() = 0;
+
+private:
+
+	static std::atomic<int> backend;
+};
@@ -0,0 +1,253 @@
+#include "plugin.hpp"
+#include "Interpolator.hpp"
+#include "SampleCache.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using simd::float_4;
+
+// filter phases between two frames, coefficients in between are interpolated
+static const int SINC_PHASES = 256;
+// passband edge, relative to the Nyquist frequency
+static const double SINC_CUTOFF = 0.9;
+// Kaiser window shapes, a short filter can't use a steep window
+static const double SINC8_KAISER_BETA = 5.0;
+static const double SINC16_KAISER_BETA = 8.0;
+// most taps of any quality
+static const int MAX_TAPS = 16;
+
+/**
+ * Modified Bessel function of the first kind, order 0, for the Kaiser window.
+ * @param x Argument.
+ * @returns I0(x).
+ */
+static double besselI0(double x) {
+	double sum = 1;
+	double term = 1;
+	for (int k = 1; k < 50; k++) {
+		term *= (x / (2 * k)) * (x / (2 * k));
+		sum += term;
+		if (term < sum * 1e-12) {
+			break;
+		}
+	}
+	return sum;
+}
+
+/**
+ * Windowed sinc filter for positions between two frames.
+ * Tap k of phase p weighs frame index - taps / 2 + 1 + k for a position
+ * p / SINC_PHASES past index. There is one phase more than SINC_PHASES, a
+ * whole frame on, so every phase has a next one to interpolate towards.
+ */
+struct SincTable {
+	int taps;
+	std::vector<float> coefficients;
+
+	SincTable(int taps, double beta) : taps(taps) {
+		int halfWidth = taps / 2;
+		coefficients.resize((SINC_PHASES + 1) * taps);
+		double windowScale = 1 / besselI0(beta);
+		for (int phase = 0; phase <= SINC_PHASES; phase++) {
+			float* phaseCoefficients = &coefficients[phase * taps];
+			double fraction = (double) phase / SINC_PHASES;
+			double sum = 0;
+			for (int tap = 0; tap < taps; tap++) {
+				double distance = tap - halfWidth + 1 - fraction;
+				double x = M_PI * SINC_CUTOFF * distance;
+				double sinc = x == 0 ? 1 : std::sin(x) / x;
+				double ratio = distance / halfWidth;
+				double window = std::abs(ratio) < 1 ? besselI0(beta * std::sqrt(1 - ratio * ratio)) * windowScale : 0;
+				phaseCoefficients[tap] = sinc * window;
+				sum += sinc * window;
+			}
+
+			// unity gain at DC, so a constant signal comes out unchanged
+			for (int tap = 0; tap < taps; tap++) {
+				phaseCoefficients[tap] /= sum;
+			}
+		}
+	}
+};
+
+// shared filter tables, built when the plugin is loaded rather than on the audio thread
+static const SincTable sinc8Table(8, SINC8_KAISER_BETA);
+static const SincTable sinc16Table(16, SINC16_KAISER_BETA);
+
+/**
+ * Shared filter tables.
+ * @param taps 8 or 16.
+ * @returns The table.
+ */
+static const SincTable& getSincTable(int taps) {
+	return taps == 8 ? sinc8Table : sinc16Table;
+}
+
+/**
+ * Copy consecutive samples of a channel, wrapped or held at the ends.
+ * @param data Sample data.
+ * @param channel Channel to read.
+ * @param first Frame of the first sample, may lie outside the data.
+ * @param count Number of samples.
+ * @param isLooped Wrap around instead of holding the first and last frame.
+ * @param out Output buffer of count samples.
+ */
+static void getTaps(const SampleData* data, int channel, int64_t first, int count, bool isLooped, float* out) {
+	const float* plane = data->planes[channel];
+	size_t stride = data->stride;
+	int64_t frameCount = data->frameCount;
+	if (first >= 0 && first + count <= frameCount) {
+		for (int k = 0; k < count; k++) {
+			out[k] = plane[(first + k) * stride];
+		}
+		return;
+	}
+	for (int k = 0; k < count; k++) {
+		int64_t frame = first + k;
+		if (isLooped) {
+			frame %= frameCount;
+			frame += frame < 0 ? frameCount : 0;
+		} else {
+			frame = std::min(std::max(frame, int64_t(0)), frameCount - 1);
+		}
+		out[k] = plane[frame * stride];
+	}
+}
+
+/**
+ * Gather the frames around a position for four channels, one vector per
+ * frame. Lanes past the last channel repeat channel c, they are computed
+ * and thrown away.
+ * @param c First of the four channels.
+ * @param x Output, x[k] is frame first + k of channels c to c + 3.
+ */
+static void getFrames(const SampleData* data, int c, int channels, int64_t first, int count, bool isLooped, float_4* x) {
+	int lanes[4];
+	for (int i = 0; i < 4; i++) {
+		lanes[i] = c + i < channels ? c + i : c;
+	}
+
+	if (first >= 0 && first + count <= (int64_t) data->frameCount) {
+		const float* p0 = data->planes[lanes[0]];
+		const float* p1 = data->planes[lanes[1]];
+		const float* p2 = data->planes[lanes[2]];
+		const float* p3 = data->planes[lanes[3]];
+		for (int k = 0; k < count; k++) {
+			size_t offset = (first + k) * data->stride;
+			x[k] = float_4(p0[offset], p1[offset], p2[offset], p3[offset]);
+		}
+		return;
+	}
+
+	float taps[4][4];
+	for (int i = 0; i < 4; i++) {
+		getTaps(data, lanes[i], first, count, isLooped, taps[i]);
+	}
+	for (int k = 0; k < count; k++) {
+		x[k] = float_4(taps[0][k], taps[1][k], taps[2][k], taps[3][k]);
+	}
+}
+
+/**
+ * Name of an interpolation quality.
+ * @param quality Quality.
+ * @returns Name for the context menu.
+ */
+const char* Interpolator::getQualityName(Quality quality) {
+	switch (quality) {
+		case QUALITY_DROP: return "Drop sample";
+		case QUALITY_LINEAR: return "Linear";
+		case QUALITY_HERMITE: return "Cubic Hermite";
+		case QUALITY_SINC8: return "Sinc, 8 taps";
+		case QUALITY_SINC16: return "Sinc, 16 taps";
+		default: return "";
+	}
+}
+
+/**
+ * Read the channels of a frame at a fractional position.
+ * Linear and Hermite compute four channels at once, sinc filters compute
+ * four taps of a channel at once. Decoded planes are read straight from
+ * memory when all taps lie inside the data.
+ * @param quality Interpolation quality.
+ * @param data Sample data.
+ * @param channels Number of channels to read, at most PORT_MAX_CHANNELS.
+ * @param index Frame before the position, inside the data.
+ * @param fraction Position past index, in units of 2^-32 frames.
+ * @param isLooped Wrap around at the ends instead of holding the first and last frame.
+ * @param out Output buffer of channels samples.
+ */
+void Interpolator::read(Quality quality, const SampleData* data, int channels, uint64_t index, uint32_t fraction, bool isLooped, float* out) {
+	float t = fraction * (1.f / 4294967296.f);
+	float result[PORT_MAX_CHANNELS];
+
+	switch (quality) {
+
+		case QUALITY_LINEAR: {
+			for (int c = 0; c < channels; c += 4) {
+				float_4 x[2];
+				getFrames(data, c, channels, index, 2, isLooped, x);
+				(x[0] + (x[1] - x[0]) * t).store(&result[c]);
+			}
+		} break;
+
+		case QUALITY_HERMITE: {
+			for (int c = 0; c < channels; c += 4) {
+				float_4 x[4];
+				getFrames(data, c, channels, (int64_t) index - 1, 4, isLooped, x);
+				float_4 c1 = 0.5f * (x[2] - x[0]);
+				float_4 c2 = x[0] - 2.5f * x[1] + 2.f * x[2] - 0.5f * x[3];
+				float_4 c3 = 0.5f * (x[3] - x[0]) + 1.5f * (x[1] - x[2]);
+				(((c3 * t + c2) * t + c1) * t + x[1]).store(&result[c]);
+			}
+		} break;
+
+		case QUALITY_SINC8:
+		case QUALITY_SINC16: {
+			const SincTable& table = getSincTable(quality == QUALITY_SINC8 ? 8 : 16);
+			int taps = table.taps;
+
+			// filter for this position, between the two nearest phases
+			int phase = fraction >> 24;
+			float weight = (fraction & 0xffffff) * (1.f / 16777216.f);
+			const float* h0 = &table.coefficients[phase * taps];
+			const float* h1 = h0 + taps;
+			float_4 h[MAX_TAPS / 4];
+			for (int k = 0; k < taps; k += 4) {
+				float_4 a = float_4::load(h0 + k);
+				float_4 b = float_4::load(h1 + k);
+				h[k / 4] = a + (b - a) * weight;
+			}
+
+			int64_t first = (int64_t) index - taps / 2 + 1;
+			bool isInside = data->stride == 1 && first >= 0 && first + taps <= (int64_t) data->frameCount;
+			for (int c = 0; c < channels; c++) {
+				float window[MAX_TAPS];
+				const float* x = window;
+				if (isInside) {
+					x = data->planes[c] + first;
+				} else {
+					getTaps(data, c, first, taps, isLooped, window);
+				}
+				float_4 sum = 0.f;
+				for (int k = 0; k < taps; k += 4) {
+					sum += float_4::load(x + k) * h[k / 4];
+				}
+				result[c] = sum[0] + sum[1] + sum[2] + sum[3];
+			}
+		} break;
+
+		case QUALITY_DROP:
+		default: {
+			size_t offset = index * data->stride;
+			for (int c = 0; c < channels; c++) {
+				result[c] = data->planes[c][offset];
+			}
+		} break;
+	}
+
+	for (int c = 0; c < channels; c++) {
+		out[c] = result[c];
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+
+struct SampleData;
+
+/**
+ * Reads a frame of decoded sample data at a fractional position.
+ *
+ * Outside the data the taps read the first or last frame, or wrap around
+ * when the sample loops. Costs are per output sample and channel, on top of
+ * a few operations per frame shared by all channels.
+ */
+struct Interpolator {
+
+	enum Quality {
+		// nearest frame before the position: 1 read, aliases at any pitch but 1
+		QUALITY_DROP,
+		// straight line between 2 frames: 2 reads, 2 multiply-adds
+		QUALITY_LINEAR,
+		// 4-point cubic Hermite: 4 reads, about 10 multiply-adds
+		QUALITY_HERMITE,
+		// 8-tap windowed sinc from a 256-phase table: 8 reads, 8 multiply-adds
+		QUALITY_SINC8,
+		// 16-tap windowed sinc from a 256-phase table: 16 reads, 16 multiply-adds
+		QUALITY_SINC16,
+		NUM_QUALITIES
+	};
+
+	// name for the context menu
+	static const char* getQualityName(Quality quality);
+
+	// read channels of a frame at index + fraction / 2^32 into out
+	static void read(Quality quality, const SampleData* data, int channels, uint64_t index, uint32_t fraction, bool isLooped, float* out);
+};
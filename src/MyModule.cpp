@@ -1,4 +1,5 @@
 #include "plugin.hpp"
+#include "FastMath.hpp"
 
 
 struct MyModule : Module {
@@ -33,7 +34,7 @@ struct MyModule : Module {
 		pitch += inputs[PITCH_INPUT].getVoltage();
 		pitch = clamp(pitch, -4.f, 4.f);
 		// The default pitch is C4 = 261.6256f
-		float freq = dsp::FREQ_C4 * std::pow(2.f, pitch);
+		float freq = dsp::FREQ_C4 * fastExp2(pitch);
 
 		// Accumulate the phase
 		phase += freq * args.sampleTime;
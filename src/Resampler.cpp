@@ -0,0 +1,235 @@
+#include "Resampler.hpp"
+#include <algorithm>
+#include <cmath>
+
+// most filter phases, ratios that need more are approximated
+static const uint64_t MAX_PHASES = 1024;
+// zero crossings of the sinc on each side of its center
+static const int ZERO_CROSSINGS = 32;
+// passband edge, relative to the Nyquist frequency of the lower rate
+static const double CUTOFF = 0.9;
+// Kaiser window shape, about 90 dB of stopband attenuation
+static const double KAISER_BETA = 9.0;
+// nonzero taps on each side of the center of the half-band filter
+static const int HALF_BAND_TAPS = 12;
+// Kaiser window shape of the half-band filter
+static const double HALF_BAND_KAISER_BETA = 8.0;
+
+static uint64_t gcd(uint64_t a, uint64_t b) {
+	while (b != 0) {
+		uint64_t r = a % b;
+		a = b;
+		b = r;
+	}
+	return a;
+}
+
+/**
+ * Modified Bessel function of the first kind, order 0, for the Kaiser window.
+ * @param x Argument.
+ * @returns I0(x).
+ */
+static double besselI0(double x) {
+	double sum = 1;
+	double term = 1;
+	for (int k = 1; k < 50; k++) {
+		term *= (x / (2 * k)) * (x / (2 * k));
+		sum += term;
+		if (term < sum * 1e-12) {
+			break;
+		}
+	}
+	return sum;
+}
+
+/**
+ * Find the closest ratio to up / down with at most MAX_PHASES as numerator,
+ * the last continued fraction convergent that fits.
+ * @param up Numerator, replaced by the approximation.
+ * @param down Denominator, replaced by the approximation.
+ */
+static void approximateRatio(uint64_t* up, uint64_t* down) {
+	uint64_t h0 = 0, h1 = 1;
+	uint64_t k0 = 1, k1 = 0;
+	uint64_t a = *up, b = *down;
+	while (b != 0) {
+		uint64_t q = a / b;
+		uint64_t h2 = q * h1 + h0;
+		uint64_t k2 = q * k1 + k0;
+		if (h2 > MAX_PHASES) {
+			break;
+		}
+		h0 = h1;
+		h1 = h2;
+		k0 = k1;
+		k1 = k2;
+		uint64_t r = a % b;
+		a = b;
+		b = r;
+	}
+	if (h1 > 0 && k1 > 0) {
+		*up = h1;
+		*down = k1;
+	}
+}
+
+/**
+ * Compute the filter phases for a rate conversion.
+ * The cutoff sits below the Nyquist frequency of the lower of the two rates,
+ * when going down the filter is stretched to keep its number of zero
+ * crossings. Each phase is scaled to unity gain at DC.
+ * @param fromRate Sample rate of the input.
+ * @param toRate Sample rate of the output.
+ */
+Resampler::Resampler(unsigned int fromRate, unsigned int toRate) {
+	uint64_t divisor = gcd(fromRate, toRate);
+	if (divisor == 0) {
+		return;
+	}
+	up = toRate / divisor;
+	down = fromRate / divisor;
+	if (up > MAX_PHASES) {
+		approximateRatio(&up, &down);
+	}
+
+	double cutoff = CUTOFF * std::min(1.0, (double) up / down);
+	halfWidth = (int) std::ceil(ZERO_CROSSINGS / cutoff);
+	int taps = 2 * halfWidth;
+	coefficients.resize(up * taps);
+	double windowScale = 1 / besselI0(KAISER_BETA);
+
+	for (uint64_t phase = 0; phase < up; phase++) {
+		float* phaseCoefficients = &coefficients[phase * taps];
+		double fraction = (double) phase / up;
+		double sum = 0;
+		for (int tap = 0; tap < taps; tap++) {
+
+			// distance of the input sample from the interpolated position
+			double distance = tap - halfWidth + 1 - fraction;
+			double x = M_PI * cutoff * distance;
+			double sinc = x == 0 ? 1 : std::sin(x) / x;
+			double ratio = distance / halfWidth;
+			double window = std::abs(ratio) < 1 ? besselI0(KAISER_BETA * std::sqrt(1 - ratio * ratio)) * windowScale : 0;
+			double value = sinc * window;
+			phaseCoefficients[tap] = value;
+			sum += value;
+		}
+		for (int tap = 0; tap < taps; tap++) {
+			phaseCoefficients[tap] /= sum;
+		}
+	}
+}
+
+/**
+ * Number of output frames for a number of input frames, so that the output
+ * covers the same length of time.
+ * @param inFrames Input frames.
+ * @returns Output frames.
+ */
+uint64_t Resampler::getOutputLength(uint64_t inFrames) const {
+	return (inFrames * up + down - 1) / down;
+}
+
+/**
+ * Convert one channel.
+ * The input is copied out with silence around it, so each output sample is
+ * one dot product of contiguous input samples and a phase.
+ * @param in Input samples.
+ * @param inFrames Number of input samples.
+ * @param out Output buffer of getOutputLength(inFrames) samples.
+ */
+void Resampler::process(const float* in, uint64_t inFrames, float* out) const {
+	uint64_t outFrames = getOutputLength(inFrames);
+	int taps = 2 * halfWidth;
+	uint64_t step = down / up;
+	uint64_t phaseStep = down % up;
+	std::vector<float> padded(inFrames + taps + 1, 0.f);
+	std::copy(in, in + inFrames, padded.begin() + halfWidth);
+
+	// output sample n is at input position index + phase / up
+	uint64_t index = 0;
+	uint64_t phase = 0;
+	for (uint64_t n = 0; n < outFrames; n++) {
+		const float* x = &padded[index + 1];
+		const float* h = &coefficients[phase * taps];
+		float sum = 0;
+		for (int tap = 0; tap < taps; tap++) {
+			sum += x[tap] * h[tap];
+		}
+		out[n] = sum;
+
+		index += step;
+		phase += phaseStep;
+		if (phase >= up) {
+			phase -= up;
+			index++;
+		}
+	}
+}
+
+/**
+ * Coefficients of the half-band filter that halve() uses.
+ * Every other tap of a half-band filter is zero, so only the center tap and
+ * the odd taps on one side of it are stored.
+ * @returns The center tap, then HALF_BAND_TAPS taps for distances 1, 3, 5...
+ */
+static const std::vector<float>& getHalfBand() {
+	static const std::vector<float> coefficients = [] {
+		std::vector<double> taps(HALF_BAND_TAPS + 1);
+		int halfWidth = 2 * HALF_BAND_TAPS;
+		double windowScale = 1 / besselI0(HALF_BAND_KAISER_BETA);
+		taps[0] = 0.5;
+		double sum = taps[0];
+		for (int k = 1; k <= HALF_BAND_TAPS; k++) {
+			double distance = 2 * k - 1;
+			double x = M_PI * 0.5 * distance;
+			double ratio = distance / halfWidth;
+			double window = besselI0(HALF_BAND_KAISER_BETA * std::sqrt(1 - ratio * ratio)) * windowScale;
+			taps[k] = 0.5 * std::sin(x) / x * window;
+			sum += 2 * taps[k];
+		}
+
+		// unity gain at DC
+		std::vector<float> coefficients(HALF_BAND_TAPS + 1);
+		for (int k = 0; k <= HALF_BAND_TAPS; k++) {
+			coefficients[k] = taps[k] / sum;
+		}
+		return coefficients;
+	}();
+	return coefficients;
+}
+
+/**
+ * Halve the sample rate of one channel.
+ * Output frame n is centred on input frame 2n, so a position p in the input
+ * is p / 2 in the output. The edges are held beyond the ends.
+ * @param in Input samples.
+ * @param stride Distance between input samples, 1 for a plane.
+ * @param inFrames Number of input frames.
+ * @param out Output buffer of getHalfLength(inFrames) samples.
+ * @param start First output frame to write, for halving a long channel in parts.
+ * @param end Output frame after the last one to write, past the end for all.
+ */
+void Resampler::halve(const float* in, size_t stride, uint64_t inFrames, float* out, uint64_t start, uint64_t end) {
+	const std::vector<float>& h = getHalfBand();
+	int64_t lastFrame = inFrames - 1;
+	uint64_t outFrames = std::min(getHalfLength(inFrames), end);
+	for (uint64_t n = start; n < outFrames; n++) {
+		int64_t middle = 2 * n;
+		float sum = h[0] * in[middle * stride];
+		if (middle >= 2 * HALF_BAND_TAPS && middle + 2 * HALF_BAND_TAPS <= lastFrame) {
+			for (int k = 1; k <= HALF_BAND_TAPS; k++) {
+				int64_t distance = 2 * k - 1;
+				sum += h[k] * (in[(middle - distance) * stride] + in[(middle + distance) * stride]);
+			}
+		} else {
+			for (int k = 1; k <= HALF_BAND_TAPS; k++) {
+				int64_t distance = 2 * k - 1;
+				int64_t before = std::max<int64_t>(middle - distance, 0);
+				int64_t after = std::min<int64_t>(middle + distance, lastFrame);
+				sum += h[k] * (in[before * stride] + in[after * stride]);
+			}
+		}
+		out[n] = sum;
+	}
+}
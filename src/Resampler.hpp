@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Polyphase windowed sinc sample rate converter for whole buffers.
+ *
+ * The rate ratio is reduced to up / down, output frame n is interpolated at
+ * input position n * down / up from one of up precomputed filter phases.
+ * Ratios that need more than 1024 phases are approximated with the
+ * closest ratio that doesn't, which is off by far less than a cent.
+ * Runs on the loader thread, not meant for real time use.
+ */
+struct Resampler {
+
+	// convert from one sample rate to another
+	Resampler(unsigned int fromRate, unsigned int toRate);
+
+	// number of output frames for a number of input frames
+	uint64_t getOutputLength(uint64_t inFrames) const;
+
+	// convert one channel, out holds getOutputLength(inFrames) samples
+	void process(const float* in, uint64_t inFrames, float* out) const;
+
+	// halve the rate of one channel with a half-band filter, writing output frames start to end of getHalfLength(inFrames)
+	static void halve(const float* in, size_t stride, uint64_t inFrames, float* out, uint64_t start = 0, uint64_t end = UINT64_MAX);
+
+	// number of output frames of halve()
+	static uint64_t getHalfLength(uint64_t inFrames) {
+		return (inFrames + 1) / 2;
+	}
+
+private:
+
+	uint64_t up = 1;
+	uint64_t down = 1;
+	// input samples on each side of the interpolated position
+	int halfWidth = 0;
+	// 2 * halfWidth coefficients for each of the up phases
+	std::vector<float> coefficients;
+};
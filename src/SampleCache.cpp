@@ -0,0 +1,593 @@
+#include "SampleCache.hpp"
+#include "FileReader.hpp"
+#include "Resampler.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+#include <sys/stat.h>
+#if defined ARCH_WIN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// 2 GB unless the plugin settings say otherwise
+static const size_t DEFAULT_BUDGET = size_t(2048) << 20;
+// compressed data read from disk at a time by the parallel block decoder
+static const size_t BLOCK_READ_SIZE = size_t(16) << 20;
+// blocks a decoder thread takes at a time
+static const drwav_uint64 BLOCK_BATCH = 64;
+// upper limit on decoder threads
+static const unsigned int MAX_DECODE_THREADS = 16;
+// pyramid levels, enough for playing 2^10 times faster
+static const int MAX_PYRAMID_LEVELS = 10;
+// shortest pyramid level
+static const drwav_uint64 MIN_PYRAMID_FRAMES = 64;
+// pyramid frames built between checks for cancellation, about a millisecond of work
+static const drwav_uint64 PYRAMID_STEP_FRAMES = 1 << 16;
+
+SampleCache::SampleCache() {
+	clock = 1;
+	budget = DEFAULT_BUDGET;
+	usage = 0;
+	evictedUsage = 0;
+}
+
+/**
+ * The cache shared by all modules of the plugin.
+ * @returns The global cache.
+ */
+SampleCache& SampleCache::global() {
+	static SampleCache cache;
+	return cache;
+}
+
+/**
+ * Get the decoded data of a Wav file.
+ * Returns the data already in use by another instance if the file did not
+ * change, otherwise decodes it. Concurrent loads of the same file wait for
+ * a single decode.
+ * @param path File path.
+ * @param sampleRate Sample rate to convert to, 0 to keep the file's rate.
+ * @param isOverBudget Set to true if the file does not fit in the budget.
+ * @returns The decoded data, or NULL if the file could not be read.
+ */
+std::shared_ptr<const SampleData> SampleCache::load(std::string path, unsigned int sampleRate, bool* isOverBudget) {
+	if (isOverBudget) {
+		*isOverBudget = false;
+	}
+
+
+	Key key;
+	if (!getKey(path, &key)) {
+		return NULL;
+	}
+	key.sampleRate = sampleRate;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	condition.wait(lock, [&] {
+		return decoding.count(key) == 0;
+	});
+
+	// evicted data is on its way out, don't hand it out again
+	std::shared_ptr<const SampleData> data = entries[key].lock();
+	if (data && !data->isEvicted) {
+		touch(data.get());
+		return data;
+	}
+	data.reset();
+
+	// drop entries of data nobody uses anymore
+	for (auto it = entries.begin(); it != entries.end();) {
+		if (it->second.expired()) {
+			it = entries.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	decoding.insert(key);
+	lock.unlock();
+	data = map(path, sampleRate);
+	if (!data) {
+		data = decode(path, sampleRate, isOverBudget);
+	}
+	lock.lock();
+	decoding.erase(key);
+	if (data) {
+		entries[key] = data;
+	}
+	lock.unlock();
+	condition.notify_all();
+	return data;
+}
+
+/**
+ * Identify a file by its canonical path, size and modification time.
+ * @param path File path.
+ * @param key The key to fill in.
+ * @returns False if the file does not exist.
+ */
+bool SampleCache::getKey(std::string path, Key* key) {
+#if defined ARCH_WIN
+	char* canonicalPath = _fullpath(NULL, path.c_str(), 0);
+#else
+	char* canonicalPath = realpath(path.c_str(), NULL);
+#endif
+	if (canonicalPath == NULL) {
+		return false;
+	}
+	key->path = canonicalPath;
+	free(canonicalPath);
+
+	struct stat fileStat;
+	if (stat(key->path.c_str(), &fileStat) != 0) {
+		return false;
+	}
+	key->size = fileStat.st_size;
+	key->modified = fileStat.st_mtime;
+	return true;
+}
+
+/**
+ * Map a whole file into memory, read-only.
+ * Nothing is read yet, pages are read in as they are touched.
+ * @param path File path.
+ * @param size Receives the file size.
+ * @returns The mapping, or NULL if the file could not be mapped.
+ */
+static void* mapFile(const std::string& path, size_t* size) {
+#if defined ARCH_WIN
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return NULL;
+	}
+	LARGE_INTEGER fileSize;
+	HANDLE mapping = NULL;
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	}
+	CloseHandle(file);
+	if (mapping == NULL) {
+		return NULL;
+	}
+
+	// the view keeps the file open
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	*size = fileSize.QuadPart;
+	return view;
+#else
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return NULL;
+	}
+	struct stat fileStat;
+	void* view = MAP_FAILED;
+	if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+		view = mmap(NULL, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (view == MAP_FAILED) {
+		return NULL;
+	}
+	*size = fileStat.st_size;
+	return view;
+#endif
+}
+
+/**
+ * Unmap a file mapped by mapFile().
+ * @param view The mapping.
+ * @param size The file size.
+ */
+static void unmapFile(void* view, size_t size) {
+#if defined ARCH_WIN
+	UnmapViewOfFile(view);
+#else
+	munmap(view, size);
+#endif
+}
+
+/**
+ * Start reading part of a mapped file in now rather than on the audio
+ * thread's first touch.
+ * @param view The mapping.
+ * @param offset First byte to read.
+ * @param length Number of bytes.
+ */
+static void prefetchMapping(void* view, size_t offset, size_t length) {
+#if !defined ARCH_WIN
+	// madvise() takes a page aligned start
+	size_t pageSize = sysconf(_SC_PAGESIZE);
+	size_t start = offset - offset % pageSize;
+	madvise(static_cast<uint8_t*>(view) + start, offset + length - start, MADV_WILLNEED);
+#endif
+}
+
+static bool isLittleEndian() {
+	uint16_t one = 1;
+	return *reinterpret_cast<uint8_t*>(&one) == 1;
+}
+
+/**
+ * Play a 32-bit float Wav file straight from a mapping of the file.
+ * The samples are used in place, so they are not copied and don't count
+ * against the budget.
+ * @param path File path.
+ * @param sampleRate Sample rate the data is for, 0 for any.
+ * @returns The data, or NULL if the file is not a float file at that rate or
+ * could not be mapped. The caller decodes the file instead.
+ */
+std::shared_ptr<const SampleData> SampleCache::map(std::string path, unsigned int sampleRate) {
+	if (!isLittleEndian()) {
+		return NULL;
+	}
+
+	size_t size;
+	void* mapping = mapFile(path, &size);
+	if (!mapping) {
+		return NULL;
+	}
+
+	drwav wav;
+	if (!drwav_init_memory(&wav, mapping, size)) {
+		unmapFile(mapping, size);
+		return NULL;
+	}
+	bool isFloat = wav.translatedFormatTag == DR_WAVE_FORMAT_IEEE_FLOAT && wav.bitsPerSample == 32;
+	bool isRate = sampleRate == 0 || sampleRate == wav.sampleRate;
+	drwav_uint64 offset = wav.dataChunkDataPos;
+	// the header can overstate the length of truncated files
+	drwav_uint64 count = offset < size ? std::min<drwav_uint64>(wav.totalSampleCount, (size - offset) / sizeof(float)) : 0;
+	count -= count % wav.channels;
+	SampleData* newData = new SampleData();
+	newData->channels = wav.channels;
+	newData->sampleRate = wav.sampleRate;
+	drwav_uninit(&wav);
+
+	// floats are read in place, so they have to be aligned
+	if (!isFloat || !isRate || offset % sizeof(float) != 0 || count == 0) {
+		delete newData;
+		unmapFile(mapping, size);
+		return NULL;
+	}
+
+	// only the header has been read so far, fetch the samples of accepted files
+	prefetchMapping(mapping, offset, count * sizeof(float));
+	newData->mapping = mapping;
+	newData->mappingSize = size;
+	const float* samples = reinterpret_cast<const float*>(static_cast<const uint8_t*>(mapping) + offset);
+	for (unsigned int channel = 0; channel < newData->channels; channel++) {
+		newData->planes.push_back(samples + channel);
+	}
+	newData->stride = newData->channels;
+	newData->frameCount = count / newData->channels;
+	std::shared_ptr<SampleData> data(newData, [this](SampleData* data) {
+		release(data);
+	});
+	touch(data.get());
+	return data;
+}
+
+/**
+ * Decode a Wav file.
+ * Sizes the buffer once from the header and decodes straight into one
+ * plane per channel, then converts the planes to the requested sample rate
+ * if the file has another one.
+ * @param path File path.
+ * @param sampleRate Sample rate to convert to, 0 to keep the file's rate.
+ * @param isOverBudget Set to true if the file does not fit in the budget.
+ * @returns The decoded data, or NULL if the file could not be read.
+ */
+std::shared_ptr<const SampleData> SampleCache::decode(std::string path, unsigned int sampleRate, bool* isOverBudget) {
+	drwav wav;
+	if (!FileReader::openWav(path, &wav)) {
+		return NULL;
+	}
+
+	// the converted data is what stays in memory
+	unsigned int channels = wav.channels;
+	drwav_uint64 planeLength = wav.totalSampleCount / channels;
+	bool isResampled = sampleRate > 0 && sampleRate != wav.sampleRate;
+	std::unique_ptr<Resampler> resampler;
+	drwav_uint64 frameCount = planeLength;
+	if (isResampled) {
+		resampler.reset(new Resampler(wav.sampleRate, sampleRate));
+		frameCount = resampler->getOutputLength(planeLength);
+	}
+	size_t bytes = frameCount * channels * sizeof(float);
+	if (!reserve(bytes)) {
+		FileReader::closeWav(&wav);
+		if (isOverBudget) {
+			*isOverBudget = true;
+		}
+		return NULL;
+	}
+
+	// give the memory back to the budget when the last holder lets go
+	SampleData* newData = new SampleData();
+	newData->bytes = bytes;
+	std::shared_ptr<SampleData> data(newData, [this](SampleData* data) {
+		release(data);
+	});
+
+	data->channels = channels;
+	data->sampleRate = wav.sampleRate;
+	data->buffer.resize(planeLength * channels);
+	drwav_uint64 framesRead;
+	if (drwav_samples_per_block(&wav) > 0) {
+		framesRead = decodeBlocks(&wav, data->buffer.data(), planeLength);
+	} else {
+		framesRead = readPlanes(&wav, data->buffer.data(), planeLength);
+	}
+	FileReader::closeWav(&wav);
+
+	// the header can overstate the length of truncated files
+	if (framesRead == 0) {
+		return NULL;
+	}
+
+	if (isResampled) {
+		drwav_uint64 outLength = resampler->getOutputLength(framesRead);
+		std::vector<float> resampled(outLength * channels);
+		for (unsigned int channel = 0; channel < channels; channel++) {
+			resampler->process(&data->buffer[channel * planeLength], framesRead, &resampled[channel * outLength]);
+		}
+		data->buffer.swap(resampled);
+		data->sampleRate = sampleRate;
+		planeLength = outLength;
+		framesRead = outLength;
+	}
+	for (unsigned int channel = 0; channel < channels; channel++) {
+		data->planes.push_back(&data->buffer[channel * planeLength]);
+	}
+	data->frameCount = framesRead;
+	touch(data.get());
+	return data;
+}
+
+/**
+ * Read a file straight into planes, dr_wav splits the channels while it converts.
+ * @param wav The file, positioned at its first sample.
+ * @param out Output buffer of wav->channels planes.
+ * @param planeLength Frames in each plane.
+ * @returns Number of frames read.
+ */
+drwav_uint64 SampleCache::readPlanes(drwav* wav, float* out, drwav_uint64 planeLength) {
+	std::vector<float*> planes(wav->channels);
+	for (unsigned int channel = 0; channel < wav->channels; channel++) {
+		planes[channel] = out + channel * planeLength;
+	}
+	return drwav_read_f32_deinterleaved(wav, planeLength, planes.data());
+}
+
+/**
+ * Decode a block-compressed (ADPCM) file on all cores.
+ * Every block holds its own decoder state, so the compressed data is read in
+ * large runs of whole blocks and the blocks of each run are shared out among
+ * threads, which write them straight to their place in the planes.
+ * @param wav The file, positioned at its first sample.
+ * @param out Output buffer of wav->channels planes.
+ * @param planeLength Frames in each plane.
+ * @returns Number of frames decoded.
+ */
+drwav_uint64 SampleCache::decodeBlocks(drwav* wav, float* out, drwav_uint64 planeLength) {
+	size_t blockSize = wav->fmt.blockAlign;
+	unsigned int channels = wav->channels;
+	drwav_uint64 framesPerBlock = drwav_samples_per_block(wav) / channels;
+
+	std::vector<drwav_uint8> raw(std::max(BLOCK_READ_SIZE / blockSize, size_t(1)) * blockSize);
+	unsigned int threadCount = std::min(std::max(std::thread::hardware_concurrency(), 1u), MAX_DECODE_THREADS);
+
+	drwav_uint64 framesDecoded = 0;
+	while (framesDecoded < planeLength) {
+		size_t bytesRead = drwav_read_raw(wav, raw.size(), raw.data());
+		if (bytesRead == 0) {
+			break;
+		}
+
+		// the last block of the file may be short
+		drwav_uint64 blockCount = (bytesRead + blockSize - 1) / blockSize;
+		drwav_uint64 firstFrame = framesDecoded;
+		std::atomic<drwav_uint64> nextBlock(0);
+		std::atomic<drwav_uint64> endFrame(firstFrame);
+
+		auto work = [&]() {
+			std::vector<drwav_int16> pcm(framesPerBlock * channels);
+			std::vector<float> samples(framesPerBlock * channels);
+			drwav_uint64 end = firstFrame;
+			while (true) {
+				drwav_uint64 block = nextBlock.fetch_add(BLOCK_BATCH, std::memory_order_relaxed);
+				if (block >= blockCount) {
+					break;
+				}
+				drwav_uint64 lastBlock = std::min(block + BLOCK_BATCH, blockCount);
+				for (; block < lastBlock; block++) {
+					drwav_uint64 pos = firstFrame + block * framesPerBlock;
+					if (pos >= planeLength) {
+						break;
+					}
+					size_t offset = block * blockSize;
+					drwav_uint64 n = drwav_decode_block_s16(wav, &raw[offset], std::min(blockSize, bytesRead - offset), pcm.data()) / channels;
+					n = std::min(n, planeLength - pos);
+					drwav_s16_to_f32(samples.data(), pcm.data(), n * channels);
+					for (unsigned int channel = 0; channel < channels; channel++) {
+						float* plane = out + channel * planeLength + pos;
+						for (drwav_uint64 i = 0; i < n; i++) {
+							plane[i] = samples[i * channels + channel];
+						}
+					}
+					end = std::max(end, pos + n);
+				}
+			}
+			drwav_uint64 seen = endFrame.load(std::memory_order_relaxed);
+			while (seen < end && !endFrame.compare_exchange_weak(seen, end, std::memory_order_relaxed)) {
+			}
+		};
+
+		// small runs aren't worth starting threads for
+		unsigned int runThreads = std::min<drwav_uint64>(threadCount, (blockCount + BLOCK_BATCH - 1) / BLOCK_BATCH);
+		std::vector<std::thread> workers;
+		for (unsigned int i = 1; i < runThreads; i++) {
+			workers.emplace_back(work);
+		}
+		work();
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+
+		framesDecoded = endFrame;
+		if (framesDecoded < firstFrame + blockCount * framesPerBlock) {
+			break;
+		}
+	}
+	return framesDecoded;
+}
+
+/**
+ * Build the pyramid of a sample's lower rate copies.
+ * Runs on a loader thread while the sample plays. Does nothing if the data
+ * already has a pyramid, is evicted, or the pyramid doesn't fit in the
+ * budget without evicting other data. The levels are built in steps of
+ * PYRAMID_STEP_FRAMES, between which isCancelled can give up the build so
+ * the caller can get to more urgent work.
+ * @param data The sample data.
+ * @param isCancelled Called between steps, true drops the partial pyramid, NULL to always finish.
+ * @returns False if the build was cancelled, true otherwise.
+ */
+bool SampleCache::buildPyramid(std::shared_ptr<const SampleData> data, std::function<bool()> isCancelled) {
+	if (!data || data->pyramid.load(std::memory_order_acquire) || data->isEvicted) {
+		return true;
+	}
+
+	// every level is half as long as the one before
+	std::vector<drwav_uint64> lengths;
+	drwav_uint64 length = data->frameCount;
+	size_t bytes = 0;
+	while ((int) lengths.size() < MAX_PYRAMID_LEVELS && length / 2 >= MIN_PYRAMID_FRAMES) {
+		length = Resampler::getHalfLength(length);
+		lengths.push_back(length);
+		bytes += length * data->channels * sizeof(float);
+	}
+	if (lengths.empty() || !reserve(bytes, false)) {
+		return true;
+	}
+
+	std::unique_ptr<SamplePyramid> pyramid(new SamplePyramid());
+	pyramid->bytes = bytes;
+	const SampleData* source = data.get();
+	for (drwav_uint64 levelLength : lengths) {
+		SampleData* level = new SampleData();
+		pyramid->levels.emplace_back(level);
+		level->channels = source->channels;
+		level->sampleRate = source->sampleRate / 2;
+		level->frameCount = levelLength;
+		level->buffer.resize(levelLength * level->channels);
+		for (unsigned int channel = 0; channel < level->channels; channel++) {
+			level->planes.push_back(&level->buffer[channel * levelLength]);
+		}
+		for (drwav_uint64 start = 0; start < levelLength; start += PYRAMID_STEP_FRAMES) {
+			if (isCancelled && isCancelled()) {
+				usage -= bytes;
+				return false;
+			}
+			for (unsigned int channel = 0; channel < level->channels; channel++) {
+				Resampler::halve(source->planes[channel], source->stride, source->frameCount, &level->buffer[channel * levelLength], start, start + PYRAMID_STEP_FRAMES);
+			}
+		}
+		source = level;
+	}
+
+	// another instance may have built one meanwhile, or the data was evicted
+	std::lock_guard<std::mutex> lock(mutex);
+	const SamplePyramid* expected = NULL;
+	if (!data->isEvicted && data->pyramid.compare_exchange_strong(expected, pyramid.get(), std::memory_order_release)) {
+		pyramid.release();
+	} else {
+		usage -= bytes;
+	}
+	return true;
+}
+
+/**
+ * Memory of data charged against the budget, including its pyramid.
+ * @param data The data.
+ * @returns Size in bytes.
+ */
+size_t SampleCache::getBytes(const SampleData* data) {
+	const SamplePyramid* pyramid = data->pyramid.load(std::memory_order_acquire);
+	return data->bytes + (pyramid ? pyramid->bytes : 0);
+}
+
+/**
+ * Charge memory against the budget, evicting least recently triggered data
+ * if needed. Evicted data only frees its memory once its holders let go.
+ * @param bytes Memory to reserve.
+ * @param canEvict False to only reserve what fits without evicting.
+ * @returns False if the memory does not fit even after evicting.
+ */
+bool SampleCache::reserve(size_t bytes, bool canEvict) {
+	std::lock_guard<std::mutex> lock(mutex);
+	size_t limit = getBudget();
+	// release() runs outside the mutex and takes evicted memory off
+	// evictedUsage before usage, so reading usage first can only overstate
+	// what is used, the clamp is for safety
+	size_t total = usage;
+	size_t evicted = evictedUsage;
+	size_t used = total - std::min(total, evicted);
+	if (limit == 0 || used + bytes <= limit) {
+		usage += bytes;
+		return true;
+	}
+	if (bytes > limit || !canEvict) {
+		return false;
+	}
+
+	// data that could be evicted, least recently triggered first
+	std::vector<std::shared_ptr<const SampleData>> candidates;
+	size_t evictable = 0;
+	for (auto& entry : entries) {
+		std::shared_ptr<const SampleData> data = entry.second.lock();
+		// evicting mapped data frees nothing, unless it has a pyramid
+		if (data && !data->isEvicted && getBytes(data.get()) > 0) {
+			candidates.push_back(data);
+			evictable += getBytes(data.get());
+		}
+	}
+	if (used + bytes - std::min(used, evictable) > limit) {
+		return false;
+	}
+	std::sort(candidates.begin(), candidates.end(), [](const std::shared_ptr<const SampleData>& a, const std::shared_ptr<const SampleData>& b) {
+		return a->lastUsed < b->lastUsed;
+	});
+
+	for (size_t i = 0; i < candidates.size() && used + bytes > limit; i++) {
+		size_t candidateBytes = getBytes(candidates[i].get());
+		candidates[i]->isEvicted = true;
+		evictedUsage += candidateBytes;
+		used -= std::min(used, candidateBytes);
+	}
+	usage += bytes;
+	return true;
+}
+
+/**
+ * Return the memory of data nobody holds anymore to the budget.
+ * @param data The data to free.
+ */
+void SampleCache::release(SampleData* data) {
+	size_t bytes = getBytes(data);
+	// evictedUsage first, see reserve()
+	if (data->isEvicted) {
+		evictedUsage -= bytes;
+	}
+	usage -= bytes;
+	if (data->mapping) {
+		unmapFile(data->mapping, data->mappingSize);
+	}
+	delete data->pyramid.load();
+	delete data;
+}
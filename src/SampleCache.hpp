@@ -0,0 +1,163 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include "dr_wav.h"
+
+struct SamplePyramid;
+
+/**
+ * Decoded audio file data, at the sample rate it was loaded for.
+ * Immutable once decoded, so any number of WavPlay instances can play it.
+ *
+ * Each channel is a plane of its own. Sample i of channel c is
+ * planes[c][i * stride]: decoded planes lie one after another in buffer
+ * with a stride of 1, mapped files keep their interleaved layout and the
+ * stride is the channel count.
+ */
+struct SampleData {
+	unsigned int channels = 0;
+	unsigned int sampleRate = 0;
+	drwav_uint64 frameCount = 0;
+
+	// first sample of each channel, in buffer or in the mapped file
+	std::vector<const float*> planes;
+	size_t stride = 1;
+	std::vector<float> buffer;
+
+	// float files are played straight from a read-only mapping of the file
+	void* mapping = NULL;
+	size_t mappingSize = 0;
+
+	// memory charged against the cache budget, 0 for mapped files
+	size_t bytes = 0;
+	// cache clock value of the last trigger, for LRU eviction
+	mutable std::atomic<uint64_t> lastUsed;
+	// set by the cache when holders should let go of this data
+	mutable std::atomic<bool> isEvicted;
+	// copies at lower rates for playing far above the original pitch, NULL until built
+	mutable std::atomic<const SamplePyramid*> pyramid;
+
+	SampleData() {
+		lastUsed = 0;
+		isEvicted = false;
+		pyramid = NULL;
+	}
+};
+
+/**
+ * Octaves of a sample for playing it far above its original pitch.
+ * Level i holds the sample at 1 / 2^(i + 1) of its rate, each level is
+ * half-band filtered from the one before it, so it has nothing above its
+ * Nyquist frequency to alias. Frame n of level i lies at frame n * 2^(i + 1)
+ * of the sample.
+ */
+struct SamplePyramid {
+	std::vector<std::unique_ptr<SampleData>> levels;
+	// memory charged against the cache budget
+	size_t bytes = 0;
+};
+
+/**
+ * Process wide cache of decoded Wav files.
+ *
+ * Files are identified by canonical path, size and modification time, so
+ * loading a file that is already in use costs a stat() call instead of a
+ * decode, and an edited file is decoded again. A file loaded for a sample
+ * rate other than its own is converted to that rate after decoding, and
+ * kept apart from the same file at other rates. The cache only holds weak
+ * references: the data is freed when the last instance lets go of it.
+ *
+ * All decoded data is charged against a memory budget. When a load would
+ * exceed it, the least recently triggered data is marked as evicted and its
+ * holders are expected to let go of it, falling back to streaming.
+ *
+ * Playing a sample far above its original pitch needs copies at lower
+ * rates. They are built on request once the data is in use, and only if
+ * they fit in the budget without evicting anything.
+ *
+ * 32-bit float files need no decoding. They are mapped into memory and
+ * played from the mapping, which shares the page cache with every other
+ * user of the file and is not charged against the budget.
+ */
+struct SampleCache {
+
+	// the cache shared by all modules of the plugin
+	static SampleCache& global();
+
+	// get the decoded data of a file at a sample rate, 0 for the file's own rate
+	std::shared_ptr<const SampleData> load(std::string path, unsigned int sampleRate = 0, bool* isOverBudget = NULL);
+
+	// add a pyramid of lower rate copies to data, if it fits in the budget, false if isCancelled stopped it
+	bool buildPyramid(std::shared_ptr<const SampleData> data, std::function<bool()> isCancelled = nullptr);
+
+	// mark data as used now, safe to call from the audio thread
+	void touch(const SampleData* data) {
+		data->lastUsed.store(clock.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+
+	// memory used by decoded data, in bytes
+	size_t getUsage() {
+		return usage.load(std::memory_order_relaxed);
+	}
+
+	// memory budget for decoded data in bytes, 0 for no limit
+	size_t getBudget() {
+		return budget.load(std::memory_order_relaxed);
+	}
+	void setBudget(size_t bytes) {
+		budget.store(bytes, std::memory_order_relaxed);
+	}
+
+private:
+
+	struct Key {
+		std::string path;
+		long long size;
+		time_t modified;
+		unsigned int sampleRate;
+
+		bool operator<(const Key& other) const {
+			if (path != other.path) {
+				return path < other.path;
+			}
+			if (size != other.size) {
+				return size < other.size;
+			}
+			if (modified != other.modified) {
+				return modified < other.modified;
+			}
+			return sampleRate < other.sampleRate;
+		}
+	};
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::map<Key, std::weak_ptr<const SampleData>> entries;
+	// files being decoded right now, other threads wait for them
+	std::set<Key> decoding;
+
+	std::atomic<uint64_t> clock;
+	std::atomic<size_t> budget;
+	std::atomic<size_t> usage;
+	// memory of evicted data that is still held by someone
+	std::atomic<size_t> evictedUsage;
+
+	SampleCache();
+	static bool getKey(std::string path, Key* key);
+	std::shared_ptr<const SampleData> decode(std::string path, unsigned int sampleRate, bool* isOverBudget);
+	std::shared_ptr<const SampleData> map(std::string path, unsigned int sampleRate);
+	static drwav_uint64 readPlanes(drwav* wav, float* out, drwav_uint64 planeLength);
+	static drwav_uint64 decodeBlocks(drwav* wav, float* out, drwav_uint64 planeLength);
+	bool reserve(size_t bytes, bool canEvict = true);
+	static size_t getBytes(const SampleData* data);
+	void release(SampleData* data);
+};
@@ -0,0 +1,245 @@
+#include "SampleStream.hpp"
+#include "FileReader.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+const drwav_uint64 SampleStream::HEAD_SIZE;
+const uint64_t SampleStream::RING_SIZE;
+const uint64_t SampleStream::RING_MARGIN;
+const uint64_t SampleStream::READ_SIZE;
+
+// generations wrap around within the bits left over by the position
+static const uint64_t GENERATION_MASK = 0xffffff;
+
+SampleStream::SampleStream() {
+	restartState = 0;
+	restartWrap = WRAP_NONE;
+	playState = 0;
+	fillState = 0;
+	underruns = 0;
+}
+
+/**
+ * Stops the streamer thread and closes the file.
+ */
+SampleStream::~SampleStream() {
+	if (thread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			isExiting = true;
+		}
+		condition.notify_one();
+		thread.join();
+	}
+	if (isOpen) {
+		FileReader::closeWav(&wav);
+	}
+}
+
+/**
+ * Open a Wav file for streaming.
+ * Decodes the head, fills the ring buffer from the start of the file and
+ * starts the streamer thread.
+ * @param path File path.
+ * @returns True if the file could be opened.
+ */
+bool SampleStream::open(std::string path) {
+	if (!FileReader::openWav(path, &wav)) {
+		return false;
+	}
+	isOpen = true;
+
+	this->path = path;
+	channels = wav.channels;
+	frameCount = wav.totalSampleCount / channels;
+	sampleRate = wav.sampleRate;
+
+	head.resize(std::min(frameCount, HEAD_SIZE) * channels);
+	wavPos = drwav_read_f32(&wav, head.size(), head.data()) / channels;
+	head.resize(wavPos * channels);
+	if (head.empty()) {
+		return false;
+	}
+
+	ring.resize(RING_SIZE * channels);
+	scratch.resize(READ_SIZE * channels);
+	silence.resize(channels, 0.f);
+	fill();
+
+	thread = std::thread(&SampleStream::run, this);
+	return true;
+}
+
+/**
+ * Start playing from a virtual position.
+ * Invalidates the ring buffer, the streamer refills it from pos.
+ * @param pos Virtual position.
+ * @param wrap How positions past the end of the file map into the file.
+ */
+void SampleStream::restart(uint64_t pos, Wrap wrap) {
+	audioGeneration = (audioGeneration + 1) & GENERATION_MASK;
+	audioWrap = wrap;
+	restartWrap.store(wrap, std::memory_order_relaxed);
+	playState.store(pack(audioGeneration, pos), std::memory_order_relaxed);
+	restartState.store(pack(audioGeneration, pos), std::memory_order_release);
+}
+
+/**
+ * Get the frame at a virtual position.
+ * Positions in the head are always available. Positions the streamer has
+ * not reached yet read as silence.
+ * @param pos Virtual position, never smaller than on the previous call.
+ * @param frame Set to the interleaved samples of the frame, valid until the
+ * next call.
+ * @returns False if playback went past the end of the file.
+ */
+bool SampleStream::read(uint64_t pos, const float** frame) {
+	if (audioWrap == WRAP_NONE && pos >= frameCount) {
+		return false;
+	}
+	playState.store(pack(audioGeneration, pos), std::memory_order_relaxed);
+
+	drwav_uint64 index = fileIndex(pos, audioWrap);
+	if (index * channels < head.size()) {
+		*frame = &head[index * channels];
+		return true;
+	}
+
+	uint64_t state = fillState.load(std::memory_order_acquire);
+	if ((state >> POS_BITS) == audioGeneration && pos < (state & POS_MASK)) {
+		*frame = &ring[(pos & (RING_SIZE - 1)) * channels];
+	} else {
+		*frame = silence.data();
+		underruns.fetch_add(1, std::memory_order_relaxed);
+	}
+	return true;
+}
+
+/**
+ * Map a virtual position to a position in the file.
+ * @param pos Virtual position.
+ * @param wrap Wrap mode.
+ * @returns Position in the file, past the end of the file only for WRAP_NONE.
+ */
+drwav_uint64 SampleStream::fileIndex(uint64_t pos, Wrap wrap) {
+	switch (wrap) {
+
+		case WRAP_LOOP:
+			return pos % frameCount;
+
+		case WRAP_PINGPONG: {
+			uint64_t phase = pos % (2 * frameCount);
+			return phase < frameCount ? phase : 2 * frameCount - 1 - phase;
+		}
+
+		case WRAP_NONE:
+		default:
+			return pos;
+	}
+}
+
+/**
+ * Top up the ring buffer up to a ring length ahead of the play position.
+ * Runs on the streamer thread, and once on the loader thread in open().
+ */
+void SampleStream::fill() {
+	uint64_t state = restartState.load(std::memory_order_acquire);
+	uint64_t generation = state >> POS_BITS;
+	if (generation != streamGeneration) {
+		streamGeneration = generation;
+		streamWrap = static_cast<Wrap>(restartWrap.load(std::memory_order_relaxed));
+		writePos = state & POS_MASK;
+		fillState.store(pack(generation, writePos), std::memory_order_release);
+	}
+
+	// the audio thread may have moved on since the restart
+	uint64_t play = playState.load(std::memory_order_relaxed);
+	uint64_t playPos = (play >> POS_BITS) == generation ? (play & POS_MASK) : writePos;
+	if (writePos < playPos) {
+		writePos = playPos;
+		fillState.store(pack(generation, writePos), std::memory_order_release);
+	}
+
+	uint64_t limit = playPos + RING_SIZE - RING_MARGIN;
+	while (writePos < limit) {
+		uint64_t count = std::min(std::min(limit - writePos, READ_SIZE), RING_SIZE - (writePos & (RING_SIZE - 1)));
+		fillRange(writePos, count);
+		writePos += count;
+		fillState.store(pack(generation, writePos), std::memory_order_release);
+
+		// stop early if the audio thread restarted meanwhile
+		if ((restartState.load(std::memory_order_relaxed) >> POS_BITS) != generation) {
+			break;
+		}
+	}
+}
+
+/**
+ * Read a run of virtual positions from disk into the ring buffer.
+ * @param pos First virtual position.
+ * @param count Number of frames, must not cross the end of the ring.
+ */
+void SampleStream::fillRange(uint64_t pos, uint64_t count) {
+	uint64_t done = 0;
+	while (done < count) {
+		uint64_t virtualPos = pos + done;
+		float* out = &ring[(virtualPos & (RING_SIZE - 1)) * channels];
+		uint64_t n = count - done;
+
+		// silence past the end of a file that doesn't loop
+		if (streamWrap == WRAP_NONE && virtualPos >= frameCount) {
+			std::memset(out, 0, n * channels * sizeof(float));
+			break;
+		}
+
+		drwav_uint64 index = fileIndex(virtualPos, streamWrap);
+		bool isReverse = streamWrap == WRAP_PINGPONG && (virtualPos % (2 * frameCount)) >= frameCount;
+		if (isReverse) {
+
+			// read the run forward, then copy its frames backwards
+			n = std::min(n, index + 1);
+			drwav_uint64 framesRead = readFile(index + 1 - n, n, scratch.data());
+			std::fill(scratch.begin() + framesRead * channels, scratch.begin() + n * channels, 0.f);
+			for (uint64_t i = 0; i < n; i++) {
+				std::copy_n(&scratch[(n - 1 - i) * channels], channels, out + i * channels);
+			}
+		} else {
+			n = std::min(n, frameCount - index);
+			drwav_uint64 framesRead = readFile(index, n, out);
+			std::fill(out + framesRead * channels, out + n * channels, 0.f);
+		}
+		done += n;
+	}
+}
+
+/**
+ * Read frames from the file, only seeking when not already there.
+ * @param index Position in the file.
+ * @param count Number of frames.
+ * @param out Output buffer.
+ * @returns Number of frames read.
+ */
+drwav_uint64 SampleStream::readFile(drwav_uint64 index, drwav_uint64 count, float* out) {
+	if (index != wavPos && !drwav_seek_to_sample(&wav, index * channels)) {
+		return 0;
+	}
+	drwav_uint64 framesRead = drwav_read_f32(&wav, count * channels, out) / channels;
+	wavPos = index + framesRead;
+	return framesRead;
+}
+
+/**
+ * Streamer thread main loop.
+ */
+void SampleStream::run() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!isExiting) {
+		lock.unlock();
+		fill();
+		lock.lock();
+		condition.wait_for(lock, std::chrono::milliseconds(2), [this] {
+			return isExiting;
+		});
+	}
+}
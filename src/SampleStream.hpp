@@ -0,0 +1,115 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "dr_wav.h"
+
+/**
+ * Plays a Wav file from disk without decoding all of it into memory.
+ *
+ * The first part of the file (the head) is decoded up front, the rest is
+ * read ahead into a ring buffer by a background thread. The audio thread
+ * plays a position that only moves forward, the 'virtual' position. The
+ * wrap mode maps it to a position in the file, so the streamer reads the
+ * region after a loop point or ping-pong turn before it is needed.
+ *
+ * Positions count frames, one sample of every channel. The head and the
+ * ring buffer hold interleaved frames.
+ */
+struct SampleStream {
+
+	// how virtual positions map to file positions
+	enum Wrap {
+		WRAP_NONE,
+		WRAP_LOOP,
+		WRAP_PINGPONG
+	};
+
+	// number of frames decoded up front
+	static const drwav_uint64 HEAD_SIZE = 1 << 17;
+	// ring buffer size in frames, a power of two
+	static const uint64_t RING_SIZE = 1 << 18;
+	// frames behind the play position the streamer leaves alone
+	static const uint64_t RING_MARGIN = 1 << 10;
+	// most frames read from disk in one go
+	static const uint64_t READ_SIZE = 1 << 14;
+
+	std::string path = "";
+	drwav_uint64 frameCount = 0;
+	unsigned int channels = 0;
+	unsigned int sampleRate = 0;
+
+	SampleStream();
+	~SampleStream();
+
+	// open the file, read the head and prime the ring buffer, runs on the loader thread
+	bool open(std::string path);
+
+	// start playing from a virtual position, runs on the audio thread
+	void restart(uint64_t pos, Wrap wrap);
+
+	// get the frame at a virtual position, runs on the audio thread
+	bool read(uint64_t pos, const float** frame);
+
+	// wrap mode the audio thread plays with
+	Wrap getWrap() {
+		return audioWrap;
+	}
+
+	// number of times the audio thread caught up with the streamer
+	uint64_t getUnderruns() {
+		return underruns.load(std::memory_order_relaxed);
+	}
+
+private:
+
+	// generation and position are packed into one atomic word
+	static const int POS_BITS = 40;
+	static const uint64_t POS_MASK = (uint64_t(1) << POS_BITS) - 1;
+
+	static uint64_t pack(uint64_t generation, uint64_t pos) {
+		return (generation << POS_BITS) | (pos & POS_MASK);
+	}
+
+	drwav wav;
+	bool isOpen = false;
+	std::vector<float> head;
+	std::vector<float> ring;
+	std::vector<float> scratch;
+	// played for frames the streamer has not reached yet
+	std::vector<float> silence;
+
+	// audio thread -> streamer: generation, wrap mode and start position of the current run
+	std::atomic<uint64_t> restartState;
+	std::atomic<int> restartWrap;
+	// audio thread -> streamer: generation and virtual position being played
+	std::atomic<uint64_t> playState;
+	// streamer -> audio thread: generation and end of the filled part of the ring
+	std::atomic<uint64_t> fillState;
+	std::atomic<uint64_t> underruns;
+
+	// audio thread state
+	uint64_t audioGeneration = 0;
+	Wrap audioWrap = WRAP_NONE;
+
+	// streamer thread state
+	uint64_t streamGeneration = 0;
+	Wrap streamWrap = WRAP_NONE;
+	uint64_t writePos = 0;
+	drwav_uint64 wavPos = 0;
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool isExiting = false;
+
+	drwav_uint64 fileIndex(uint64_t pos, Wrap wrap);
+	void fill();
+	void fillRange(uint64_t pos, uint64_t count);
+	drwav_uint64 readFile(drwav_uint64 index, drwav_uint64 count, float* out);
+	void run();
+};
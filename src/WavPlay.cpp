@@ -1,10 +1,60 @@
 #include "plugin.hpp"
 #include "cmath"
-#include <dirent.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "DirectoryIndex.hpp"
+#include "SampleCache.hpp"
+#include "FileReader.hpp"
+#include "Interpolator.hpp"
+#include "SampleStream.hpp"
+#include "FastMath.hpp"
 #define DR_WAV_IMPLEMENTATION
 #include "dr_wav.h"
 #include "osdialog.h"
 
+// fraction bits of the play position, 32.32 fixed point
+static const int PLAYHEAD_BITS = 32;
+static const uint64_t PLAYHEAD_ONE = uint64_t(1) << PLAYHEAD_BITS;
+// longest decoded sample played, its end and a step of up to 2^63 still fit in the play position
+static const drwav_uint64 MAX_PLAYHEAD_FRAMES = (UINT64_MAX >> PLAYHEAD_BITS) >> 1;
+// samples between updates of the panel controls and lights
+static const uint32_t CONTROL_DIVISION = 16;
+// octaves at the top of each pyramid level over which it fades into the next
+static const float PYRAMID_FADE_OCTAVES = 0.25f;
+
+/**
+ * Loaded audio file.
+ * Created on the loader thread and handed to the audio thread in one piece,
+ * so the audio thread never sees a half filled buffer.
+ */
+struct Sample {
+	unsigned int channels = 0;
+	// rate of the samples as played, the engine rate unless streamed from disk
+	unsigned int sampleRate = 0;
+	drwav_uint64 frameCount = 0;
+	std::string fileDesc = "";
+
+	// decoded data, shared with other instances playing the same file
+	std::shared_ptr<const SampleData> data;
+
+	// set instead of data when the file is streamed from disk
+	std::unique_ptr<SampleStream> stream;
+
+	// replaces the previous sample of the same file, playback carries on from the same time
+	bool isContinuation = false;
+
+	// loaded by a NEXT or PREV trigger, playback restarts from the beginning
+	bool isStep = false;
+
+	// position in the directory's list of wav files, -1 if not listed
+	int fileIndex = -1;
+	int fileCount = 0;
+};
+
 /**
  * DSP processor
  * rack::engine::Module
@@ -22,6 +72,8 @@ struct WavPlay : Module {
 	enum InputIds {
 		TRIGGER_INPUT,
 		PITCH_INPUT,
+		NEXT_INPUT,
+		PREV_INPUT,
 		NUM_INPUTS
 	};
 	enum OutputIds {
@@ -46,21 +98,57 @@ struct WavPlay : Module {
 		NUM_PLAYMODES
 	};
 
-	bool isLoading = false;
-	bool isFileLoaded = true;
+	std::atomic<bool> isLoading;
+	std::atomic<bool> isFileLoaded;
 	bool isPlaying = false;
-	bool isReloading = false;
 	bool isPingPongLoopreverse = false;
+	bool isStreaming = false;
 	PlayMode playMode = LOOP_OFF;
-	int sampnumber = 0;
-	float samplePos = 0;
-	unsigned int channels;
-	unsigned int sampleRate;
-	drwav_uint64 totalSampleCount;
+	Interpolator::Quality interpolation = Interpolator::QUALITY_LINEAR;
+	// follow the pitch input at audio rate instead of ramping between control updates
+	bool isAudioRateFm = false;
+	// play position in frames, 32.32 fixed point so long files keep the exact pitch
+	uint64_t playhead = 0;
+	double streamPos = 0;
 	std::string lastPath = "";
-	std::string fileDesc = "";
-	std::vector<std::vector<float>> playBuffer;
-	std::vector<std::string> fileNames;
+
+	// sample played by the audio thread, only accessed from process()
+	Sample* sample = NULL;
+	// decoded sample waiting for the audio thread to pick it up
+	std::atomic<Sample*> pendingSample;
+	// sample released by the audio thread, deleted on the loader thread
+	std::atomic<Sample*> retiredSample;
+	// the files before and after the playing one, decoded ahead for PREV and NEXT
+	std::atomic<Sample*> prevSample;
+	std::atomic<Sample*> nextSample;
+	// directory index the audio thread wants loaded, -1 for none
+	std::atomic<int> requestedIndex;
+	// directory index of the sample the audio thread plays
+	std::atomic<int> playingIndex;
+	// engine sample rate that files are decoded for
+	std::atomic<unsigned int> engineSampleRate;
+
+	// background thread that decodes files, woken by loadWavFile()
+	std::thread loaderThread;
+	std::mutex loaderMutex;
+	std::condition_variable loaderCondition;
+	std::string loaderPath = "";
+	bool loaderRequest = false;
+	bool loaderStreaming = false;
+	bool loaderRateChange = false;
+	bool loaderExit = false;
+
+	// last loaded file, only accessed from the loader thread
+	std::string loadedPath = "";
+	std::weak_ptr<const SampleData> loadedData;
+
+	// wav files in the loaded file's directory, only accessed from the loader thread
+	std::shared_ptr<const DirectoryListing> listing = std::make_shared<DirectoryListing>();
+	int sampnumber = -1;
+	// directory index the neighbour slots were filled for, and their data
+	int prefetchedIndex = -1;
+	std::weak_ptr<const SampleData> nextData;
+	std::weak_ptr<const SampleData> prevData;
 
 	// SchmittTrigger: Turns HIGH when value reaches 1.f, turns LOW when value reaches 0.f.
 	dsp::SchmittTrigger loadsampleTrigger;
@@ -70,23 +158,101 @@ struct WavPlay : Module {
 	dsp::SchmittTrigger prevTrigger;
 	dsp::SchmittTrigger playModeTrigger;
 
+	// controls are read every CONTROL_DIVISION samples, pitch ramps in between
+	dsp::ClockDivider controlDivider;
+	bool isGateMode = false;
+	float sampleAdvance = 1.f;
+	float sampleAdvanceRamp = 0.f;
+
 	// Constructs a Module with no params, inputs, outputs, and lights.
 	WavPlay() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 		configParam(PITCH_PARAM, 0.f, 1.f, 0.f, "");
-		playBuffer.resize(1);
-		playBuffer[0].resize(0);
+		isLoading = false;
+		isFileLoaded = true;
+		pendingSample = NULL;
+		retiredSample = NULL;
+		prevSample = NULL;
+		nextSample = NULL;
+		requestedIndex = -1;
+		playingIndex = -1;
+		engineSampleRate = (unsigned int) std::round(APP->engine->getSampleRate());
+		controlDivider.setDivision(CONTROL_DIVISION);
+		loaderThread = std::thread(&WavPlay::loaderRun, this);
+	}
+
+	// Stops the loader thread and frees all samples.
+	~WavPlay() {
+		{
+			std::lock_guard<std::mutex> lock(loaderMutex);
+			loaderExit = true;
+		}
+		loaderCondition.notify_one();
+		loaderThread.join();
+		delete sample;
+		delete pendingSample.exchange(NULL);
+		delete retiredSample.exchange(NULL);
+		delete prevSample.exchange(NULL);
+		delete nextSample.exchange(NULL);
 	}
 
 	// advances the module by one audio sample
 	void process(const ProcessArgs& args) override;
 
+	// convert the decoded files to the new engine sample rate
+	void onSampleRateChange() override;
+
 	// set play mode, loop etc.
 	void setPlayMode(int mode);
 
-	// load a wav file
+	// read the panel controls and update the lights, every CONTROL_DIVISION samples
+	void processControls();
+
+	// frames the play position moves per output sample at the pitch input's voltage
+	float getSampleAdvance();
+
+	// request a wav file to be loaded in the background
 	void loadWavFile(std::string path);
 
+	// loader thread main loop
+	void loaderRun();
+
+	// hand a sample to the audio thread, runs on the loader thread
+	void publishSample(Sample* newSample);
+
+	// decode a wav file, runs on the loader thread
+	Sample* decodeWavFile(std::string path);
+
+	// open a wav file for streaming, runs on the loader thread
+	Sample* streamWavFile(std::string path);
+
+	// load a file from the directory list, runs on the loader thread
+	Sample* loadIndexedFile(int index, bool isStreamed);
+
+	// fill the neighbour slots around a directory index, runs on the loader thread
+	void prefetchNeighbours(int index, bool isStreamed);
+
+	// true if the sample cache evicted a neighbour, runs on the loader thread
+	bool isNeighbourEvicted();
+
+	// true if the loader has work more urgent than a pyramid, runs on the loader thread
+	bool isLoaderNeeded();
+
+	// list the wav files in a file's directory, runs on the loader thread
+	void indexDirectory(std::string path);
+
+	// swap in a newly loaded sample, runs on the audio thread
+	void acquireSample();
+
+	// switch to the next or previous file in the directory, runs on the audio thread
+	void stepSample(int step);
+
+	// read the frame at the play position of a decoded sample
+	void readFrame(float sampleAdvance, float* frame);
+
+	// how the stream wraps in the current play mode
+	SampleStream::Wrap getStreamWrap();
+
 	// persist module data
 	json_t *dataToJson() override;
 	void dataFromJson(json_t* root) override;
@@ -100,6 +266,9 @@ json_t *WavPlay::dataToJson() {
 	json_t *rootJ = json_object();
 	json_object_set_new(rootJ, "lastPath", json_string(lastPath.c_str()));
 	json_object_set_new(rootJ, "playMode", json_integer(playMode));
+	json_object_set_new(rootJ, "streaming", json_boolean(isStreaming));
+	json_object_set_new(rootJ, "interpolation", json_integer(interpolation));
+	json_object_set_new(rootJ, "audioRateFm", json_boolean(isAudioRateFm));
 	return rootJ;
 }
 
@@ -108,10 +277,23 @@ json_t *WavPlay::dataToJson() {
  * @param rootJ
  */
 void WavPlay::dataFromJson(json_t* rootJ) {
+	json_t *streamingJ = json_object_get(rootJ, "streaming");
+	isStreaming = streamingJ && json_is_true(streamingJ);
+
+	json_t *audioRateFmJ = json_object_get(rootJ, "audioRateFm");
+	isAudioRateFm = audioRateFmJ && json_is_true(audioRateFmJ);
+
+	json_t *interpolationJ = json_object_get(rootJ, "interpolation");
+	if (interpolationJ) {
+		int quality = json_integer_value(interpolationJ);
+		if (quality >= 0 && quality < Interpolator::NUM_QUALITIES) {
+			interpolation = static_cast<Interpolator::Quality>(quality);
+		}
+	}
+
 	json_t *lastPathJ = json_object_get(rootJ, "lastPath");
 	if (lastPathJ) {
 		lastPath = json_string_value(lastPathJ);
-		isReloading = true ;
 		loadWavFile(lastPath);
 	}
 
@@ -128,10 +310,21 @@ void WavPlay::dataFromJson(json_t* rootJ) {
  */
 void WavPlay::process(const ProcessArgs& args) {
 
-	// play mode change
-	if (playModeTrigger.process(params[PLAY_MODE_PARAM].value)) {
-		int nextPlayMode = (playMode + 1) % NUM_PLAYMODES;
-		setPlayMode(nextPlayMode);
+	// pick up a sample published by the loader thread
+	acquireSample();
+
+	// panel controls, lights and the pitch ramp
+	if (controlDivider.process()) {
+		processControls();
+	}
+	sampleAdvance += sampleAdvanceRamp;
+
+	// step through the files in the directory
+	if (nextTrigger.process(inputs[NEXT_INPUT].value)) {
+		stepSample(1);
+	}
+	if (prevTrigger.process(inputs[PREV_INPUT].value)) {
+		stepSample(-1);
 	}
 
 	// trigger input changes
@@ -140,55 +333,89 @@ void WavPlay::process(const ProcessArgs& args) {
 		// if the input value triggers the schmittrigger to flip HIGH
 		if (playTrigger.process(inputs[TRIGGER_INPUT].value)) {
 			isPlaying = true;
-			samplePos = 0;
+			playhead = 0;
+			streamPos = 0;
+			if (sample && sample->stream) {
+				sample->stream->restart(0, getStreamWrap());
+			}
+			if (sample && sample->data) {
+				SampleCache::global().touch(sample->data.get());
+			}
 		}
 
 		// if in gate mode and the input value reaches 0
-		if (params[TRIG_MODE_PARAM].value > 0.0f) {
+		if (isGateMode) {
 			if (stopTrigger.process(1 - inputs[TRIGGER_INPUT].value)) {
 				isPlaying = false;
 			}
 		}
 	}
 
+	// all channels of the file go out on one polyphonic cable
+	int channels = sample ? std::min<int>(sample->channels, PORT_MAX_CHANNELS) : 1;
+	outputs[AUDIO_OUTPUT].setChannels(channels);
+
 	// play and advance sample
-	if (!isLoading && isPlaying) { // && (std::abs(floor(samplePos)) < totalSampleCount)) {
+	if (sample && isPlaying) {
+		drwav_uint64 frameCount = sample->frameCount;
 
-		// play
-		if (samplePos >= 0) {
-			outputs[AUDIO_OUTPUT].value = 5 * playBuffer[0][floor(samplePos)];
-		} else {
-			outputs[AUDIO_OUTPUT].value = 5 * playBuffer[0][floor(totalSampleCount - 1 + samplePos)];
+		// relative advance of sample position, ramped towards the last control update
+		if (isAudioRateFm) {
+			sampleAdvance = getSampleAdvance();
 		}
 
-		// relative advance of sample position
-		float sampleAdvance;
-		if (inputs[PITCH_INPUT].isConnected()) {
-			sampleAdvance = powf(2.0, inputs[PITCH_INPUT].value) + (params[PITCH_PARAM].value / 3);
-		} else {
-			sampleAdvance = 1 + (params[PITCH_PARAM].value / 3);
+		// streamed files wrap inside the stream, the position only moves forward
+		if (sample->stream) {
+			SampleStream::Wrap wrap = getStreamWrap();
+			if (wrap != sample->stream->getWrap()) {
+				sample->stream->restart(streamPos, wrap);
+			}
+
+			// streams play at the file's rate
+			const float* frame = NULL;
+			isPlaying = sample->stream->read(streamPos, &frame);
+			for (int c = 0; c < channels; c++) {
+				outputs[AUDIO_OUTPUT].setVoltage(isPlaying ? 5 * frame[c] : 0.f, c);
+			}
+			streamPos += sampleAdvance * sample->sampleRate * args.sampleTime;
+			return;
+		}
+
+		// play, interpolated between the frames around the position
+		float frame[PORT_MAX_CHANNELS];
+		readFrame(sampleAdvance, frame);
+		for (int c = 0; c < channels; c++) {
+			outputs[AUDIO_OUTPUT].setVoltage(5 * frame[c], c);
 		}
 
-		// set new sample position based on play mode
+		// set new sample position based on play mode, the wraps are rare branches
+		uint64_t step = (uint64_t) (int64_t) (sampleAdvance * PLAYHEAD_ONE);
+		uint64_t end = frameCount << PLAYHEAD_BITS;
 		switch (playMode) {
 
 			case LOOP:
-				samplePos	= fmod(samplePos + sampleAdvance, totalSampleCount);
+				playhead += step;
+				if (playhead >= end) {
+					playhead %= end;
+				}
 				break;
 
 			case LOOP_PINGPONG:
+
+				// turn around just inside the ends, so the position always stays on a frame
 				if (isPingPongLoopreverse) {
-					if (samplePos - sampleAdvance >= 0) {
-						samplePos	= samplePos - sampleAdvance;
+					if (step <= playhead) {
+						playhead -= step;
 					} else {
-						samplePos = std::abs(samplePos - sampleAdvance);
+						playhead = std::min(step - playhead, end - 1);
 						isPingPongLoopreverse = false;
 					}
 				} else {
-					if (samplePos + sampleAdvance < totalSampleCount) {
-						samplePos	= samplePos + sampleAdvance;
+					if (playhead + step < end) {
+						playhead += step;
 					} else {
-						samplePos	= totalSampleCount + totalSampleCount - samplePos - sampleAdvance;
+						uint64_t over = playhead + step - end;
+						playhead = over < end ? end - 1 - over : 0;
 						isPingPongLoopreverse = true;
 					}
 				}
@@ -198,20 +425,115 @@ void WavPlay::process(const ProcessArgs& args) {
 			case LOOP_XFADE:
 				// TODO: implement
 			default:
-				samplePos	= samplePos + sampleAdvance;
-				isPlaying = std::abs(floor(samplePos)) < totalSampleCount;
+				playhead += step;
+				isPlaying = playhead < end;
 		}
 	} else {
 
 		// stop play
 		isPlaying = false;
-		outputs[AUDIO_OUTPUT].value = 0;
+		for (int c = 0; c < channels; c++) {
+			outputs[AUDIO_OUTPUT].setVoltage(0.f, c);
+		}
 	}
+}
+
+/**
+ * Read the panel controls and update the lights.
+ * Runs every CONTROL_DIVISION samples. Sets the pitch ramp so the advance
+ * reaches the current pitch by the next update.
+ */
+void WavPlay::processControls() {
+
+	// play mode change
+	if (playModeTrigger.process(params[PLAY_MODE_PARAM].value)) {
+		int nextPlayMode = (playMode + 1) % NUM_PLAYMODES;
+		setPlayMode(nextPlayMode);
+	}
+
+	isGateMode = params[TRIG_MODE_PARAM].value > 0.0f;
+	sampleAdvanceRamp = (getSampleAdvance() - sampleAdvance) / CONTROL_DIVISION;
 
 	// light on while sample plays
 	lights[ISPLAYING_LIGHT].setBrightness(isPlaying ? 1.f : 0.f);
 }
 
+/**
+ * Frames the play position moves per output sample.
+ * @returns The advance at the pitch knob and input.
+ */
+float WavPlay::getSampleAdvance() {
+	if (inputs[PITCH_INPUT].isConnected()) {
+		return fastExp2(inputs[PITCH_INPUT].value) + (params[PITCH_PARAM].value / 3);
+	}
+	return 1 + (params[PITCH_PARAM].value / 3);
+}
+
+/**
+ * Read the frame at the play position of a decoded sample.
+ * Above the original pitch the frame is read from the first pyramid level
+ * that plays at no more than its own rate, so what it holds stays below the
+ * output's Nyquist frequency. Over the top PYRAMID_FADE_OCTAVES of its range
+ * it is crossfaded into the next level, which takes over at the octave
+ * boundary. The cost stays the same at any pitch. Until the pyramid is
+ * built the sample itself is read.
+ * @param sampleAdvance Frames the position moves per output sample.
+ * @param frame Output buffer of PORT_MAX_CHANNELS samples.
+ */
+void WavPlay::readFrame(float sampleAdvance, float* frame) {
+	const SampleData* data = sample->data.get();
+	int channels = std::min<int>(sample->channels, PORT_MAX_CHANNELS);
+	bool isLooped = playMode == LOOP;
+	const SamplePyramid* pyramid = data->pyramid.load(std::memory_order_acquire);
+	if (!pyramid || sampleAdvance <= 1) {
+		Interpolator::read(interpolation, data, channels, playhead >> PLAYHEAD_BITS, (uint32_t) playhead, isLooped, frame);
+		return;
+	}
+
+	// level 0 is the sample, level i the pyramid's level i - 1 and played
+	// 2^i times slower, the lowest level that doesn't alias is ceil(octave)
+	int levelCount = pyramid->levels.size() + 1;
+	float octave = std::log2(sampleAdvance);
+	int level = (int) octave;
+	level = std::min(level + (octave > level), levelCount - 1);
+	float fade = 0.f;
+	if (level + 1 < levelCount) {
+		fade = std::min(std::max((octave - level) / PYRAMID_FADE_OCTAVES + 1.f, 0.f), 1.f);
+	}
+	const SampleData* lower = level > 0 ? pyramid->levels[level - 1].get() : data;
+	uint64_t position = playhead >> level;
+	Interpolator::read(interpolation, lower, channels, position >> PLAYHEAD_BITS, (uint32_t) position, isLooped, frame);
+	if (fade > 0.f) {
+		float upperFrame[PORT_MAX_CHANNELS];
+		const SampleData* upper = pyramid->levels[level].get();
+		position = playhead >> (level + 1);
+		Interpolator::read(interpolation, upper, channels, position >> PLAYHEAD_BITS, (uint32_t) position, isLooped, upperFrame);
+		for (int c = 0; c < channels; c++) {
+			frame[c] += (upperFrame[c] - frame[c]) * fade;
+		}
+	}
+}
+
+/**
+ * Map the play mode to the way a streamed file wraps around.
+ * @returns Wrap mode for SampleStream.
+ */
+SampleStream::Wrap WavPlay::getStreamWrap() {
+	switch (playMode) {
+
+		case LOOP:
+			return SampleStream::WRAP_LOOP;
+
+		case LOOP_PINGPONG:
+			return SampleStream::WRAP_PINGPONG;
+
+		case LOOP_OFF:
+		case LOOP_XFADE:
+		default:
+			return SampleStream::WRAP_NONE;
+	}
+}
+
 /**
  * Set the sample play mode.
  * @param mode Play mode integer to be cast to enum PlayMode.
@@ -240,77 +562,397 @@ void WavPlay::setPlayMode(int mode) {
 }
 
 /**
- * Load a Wav audio file.
+ * Swap in the sample the loader thread published, if any.
+ * Runs on the audio thread. It never frees memory: the sample it lets go of
+ * is handed back to the loader thread, so only one swap can be in flight.
+ */
+void WavPlay::acquireSample() {
+	if (pendingSample.load(std::memory_order_relaxed) == NULL || retiredSample.load(std::memory_order_acquire) != NULL) {
+		return;
+	}
+
+	Sample* newSample = pendingSample.exchange(NULL, std::memory_order_acq_rel);
+	if (newSample) {
+
+		// continuations replace a decoded sample, possibly at another rate
+		double scale = sample ? (double) newSample->sampleRate / sample->sampleRate : 1;
+		retiredSample.store(sample, std::memory_order_release);
+		sample = newSample;
+		playingIndex.store(sample->fileIndex, std::memory_order_relaxed);
+		if (sample->isContinuation && sample->stream) {
+			streamPos = (double) playhead / PLAYHEAD_ONE * scale;
+			sample->stream->restart(streamPos, getStreamWrap());
+		} else if (sample->isContinuation) {
+			playhead = std::min((uint64_t) (playhead * scale), (sample->frameCount << PLAYHEAD_BITS) - 1);
+		} else {
+			playhead = 0;
+			streamPos = 0;
+			isPingPongLoopreverse = false;
+			if (sample->isStep && sample->stream) {
+				sample->stream->restart(0, getStreamWrap());
+			}
+			isPlaying = isPlaying && sample->isStep;
+		}
+	}
+}
+
+/**
+ * Switch to the next or previous wav file in the directory.
+ * Runs on the audio thread. The neighbour the loader thread decoded ahead
+ * is swapped in right away, playback carries on from its beginning. If it
+ * isn't ready the loader thread is asked to load the file instead.
+ * @param step 1 for the next file, -1 for the previous one.
+ */
+void WavPlay::stepSample(int step) {
+	if (!sample || sample->fileIndex < 0 || sample->fileCount < 2) {
+		return;
+	}
+	int index = (sample->fileIndex + step + sample->fileCount) % sample->fileCount;
+
+	// only one sample can be handed back to the loader thread at a time
+	if (retiredSample.load(std::memory_order_acquire) != NULL) {
+		requestedIndex.store(index, std::memory_order_relaxed);
+		return;
+	}
+
+	std::atomic<Sample*>& slot = step > 0 ? nextSample : prevSample;
+	Sample* newSample = slot.exchange(NULL, std::memory_order_acq_rel);
+	if (!newSample || newSample->fileIndex != index) {
+
+		// missing or left over from an earlier position
+		retiredSample.store(newSample, std::memory_order_release);
+		requestedIndex.store(index, std::memory_order_relaxed);
+		return;
+	}
+
+	retiredSample.store(sample, std::memory_order_release);
+	sample = newSample;
+	playingIndex.store(index, std::memory_order_relaxed);
+	playhead = 0;
+	streamPos = 0;
+	isPingPongLoopreverse = false;
+	if (sample->stream) {
+		sample->stream->restart(0, getStreamWrap());
+	}
+}
+
+/**
+ * Ask the loader thread to decode the playing file and its neighbours again
+ * at the new engine sample rate. Playback carries on at the old rate until
+ * the converted sample is swapped in.
+ */
+void WavPlay::onSampleRateChange() {
+	{
+		std::lock_guard<std::mutex> lock(loaderMutex);
+		engineSampleRate = (unsigned int) std::round(APP->engine->getSampleRate());
+		loaderRateChange = true;
+	}
+	loaderCondition.notify_one();
+}
+
+/**
+ * Request a Wav audio file to be loaded.
+ * Returns immediately, the file is decoded on the loader thread.
  * @param path File path.
  */
 void WavPlay::loadWavFile(std::string path) {
-	isLoading = true;
-	unsigned int _channels;
-	unsigned int _sampleRate;
-	drwav_uint64 _totalSampleCount;
-	float* pSampleData;
-
-	pSampleData = drwav_open_and_read_file_f32(path.c_str(), &_channels, &_sampleRate, &_totalSampleCount);
-
-	if (pSampleData != NULL) {
-		channels = _channels;
-		sampleRate = _sampleRate;
-
-		// clear playBuffer and fill with the loaded samples
-		playBuffer[0].clear();
-		for (unsigned int i = 0; i < _totalSampleCount; i++) {
-			playBuffer[0].push_back(pSampleData[i]);
+	{
+		std::lock_guard<std::mutex> lock(loaderMutex);
+		loaderPath = path;
+		loaderRequest = true;
+		loaderStreaming = isStreaming;
+		isLoading = true;
+	}
+	loaderCondition.notify_one();
+}
+
+/**
+ * Loader thread main loop.
+ * Decodes requested files, keeps the neighbours of the playing file decoded,
+ * deletes samples retired by the audio thread and switches to streaming
+ * when the sample cache evicts the loaded data.
+ */
+void WavPlay::loaderRun() {
+	std::unique_lock<std::mutex> lock(loaderMutex);
+	while (!loaderExit) {
+		loaderCondition.wait_for(lock, std::chrono::milliseconds(50), [this] {
+			return loaderRequest || loaderRateChange || loaderExit;
+		});
+		bool isStreamed = loaderStreaming;
+
+		// a NEXT or PREV trigger found no neighbour ready
+		int index = requestedIndex.exchange(-1, std::memory_order_relaxed);
+		if (index >= 0) {
+			lock.unlock();
+			Sample* newSample = loadIndexedFile(index, isStreamed);
+			if (newSample) {
+				newSample->isStep = true;
+				publishSample(newSample);
+			}
+			lock.lock();
 		}
-		totalSampleCount = playBuffer[0].size();
-		drwav_free(pSampleData);
 
-		isLoading = false;
-		isFileLoaded = true;
-		fileDesc = rack::string::filename(path);
-
-		if (isReloading) {
-			DIR* directory = NULL;
-			struct dirent* directoryEntry = NULL;
-			std::string directoryName = path.empty() ? asset::user("") : rack::string::directory(path);
-			directory = opendir(directoryName.c_str());
-			int i = 0;
-			fileNames.clear();
-
-			// store all the directory's wav file names in vector wavFiles
-			while ((directoryEntry = readdir(directory)) != NULL) {
-				std::string fileName = directoryEntry->d_name;
-				std::size_t found = fileName.find(".wav", fileName.length() - 5);
-				if (found == std::string::npos) {
-					found = fileName.find(".WAV", fileName.length() - 5);
-
-  				if (found != std::string::npos) {
-						fileNames.push_back(fileName);
-						if ((directoryName + "/" + fileName) == path) {
-							sampnumber = i;
-						}
-						i = i + 1;
-					}
+		// the engine rate changed, decoded files are converted again
+		if (loaderRateChange && !loaderExit) {
+			loaderRateChange = false;
+			lock.unlock();
+			if (loadedData.lock()) {
+				Sample* newSample = decodeWavFile(loadedPath);
+				if (newSample) {
+					newSample->isContinuation = true;
+					newSample->fileIndex = playingIndex.load(std::memory_order_relaxed);
+					newSample->fileCount = listing->files.size();
+					loadedData = newSample->data;
+					publishSample(newSample);
 				}
 			}
+			prefetchedIndex = -1;
+			lock.lock();
+		}
 
-			// Linux needs this to get files in the right order
-			sort(fileNames.begin(), fileNames.end());
-			for (int fileIndex = 0; fileIndex < int(fileNames.size() - 1); fileIndex++) {
-				if ((directoryName + "/" + fileNames[fileIndex]) == path) {
-					sampnumber = fileIndex;
-				}
+		// before the retired sample goes, it may be the new neighbour
+		index = playingIndex.load(std::memory_order_relaxed);
+		if (index >= 0 && (index != prefetchedIndex || isNeighbourEvicted())) {
+			lock.unlock();
+			prefetchNeighbours(index, isStreamed);
+			lock.lock();
+		}
+
+		delete retiredSample.exchange(NULL, std::memory_order_acq_rel);
+
+		// the playing file gets its octaves for high pitches once nothing else
+		// waits, the build gives up when something does and starts over later
+		std::shared_ptr<const SampleData> data = loadedData.lock();
+		if (data && !loaderRequest && !data->pyramid.load(std::memory_order_acquire)) {
+			lock.unlock();
+			SampleCache::global().buildPyramid(data, [this] {
+				return isLoaderNeeded();
+			});
+			lock.lock();
+		}
+
+		if (data && data->isEvicted) {
+			data.reset();
+			loadedData.reset();
+			lock.unlock();
+			Sample* newSample = streamWavFile(loadedPath);
+			if (newSample) {
+				newSample->isContinuation = true;
+				newSample->fileIndex = playingIndex.load(std::memory_order_relaxed);
+				newSample->fileCount = listing->files.size();
+				publishSample(newSample);
+			}
+			lock.lock();
+		}
+
+		if (loaderRequest && !loaderExit) {
+			std::string path = loaderPath;
+			loaderRequest = false;
+			lock.unlock();
+
+			Sample* newSample = isStreamed ? streamWavFile(path) : decodeWavFile(path);
+			if (newSample) {
+				indexDirectory(path);
+				newSample->fileIndex = sampnumber;
+				newSample->fileCount = listing->files.size();
+				loadedPath = path;
+				loadedData = newSample->data;
+				publishSample(newSample);
 			}
+			isFileLoaded = newSample != NULL;
 
-			closedir(directory);
-			isReloading = false;
+			lock.lock();
+			isLoading = loaderRequest;
 		}
+	}
+}
 
-		lastPath = path;
-	} else {
+/**
+ * Hand a sample to the audio thread.
+ * Runs on the loader thread.
+ * @param newSample The sample, NULL is ignored.
+ */
+void WavPlay::publishSample(Sample* newSample) {
+	if (newSample) {
+		// a previous sample the audio thread never picked up can go right away
+		delete pendingSample.exchange(newSample, std::memory_order_acq_rel);
+	}
+}
+
+/**
+ * Load a decoded Wav audio file, converted to the engine sample rate.
+ * Runs on the loader thread. Files already in use by other instances are
+ * shared instead of decoded again, files that don't fit in the sample
+ * memory budget are streamed.
+ * @param path File path.
+ * @returns The sample, or NULL if the file could not be read.
+ */
+Sample* WavPlay::decodeWavFile(std::string path) {
+	bool isOverBudget;
+	std::shared_ptr<const SampleData> data = SampleCache::global().load(path, engineSampleRate, &isOverBudget);
+	if (!data) {
+		if (isOverBudget) {
+			return streamWavFile(path);
+		}
 
 		// no sampleData loaded
-		isFileLoaded = false;
+		return NULL;
+	}
+
+	Sample* newSample = new Sample();
+	newSample->channels = data->channels;
+	newSample->sampleRate = data->sampleRate;
+	// W64 files can be longer than the play position can address, the rest isn't played
+	newSample->frameCount = std::min(data->frameCount, MAX_PLAYHEAD_FRAMES);
+	newSample->fileDesc = rack::string::filename(path);
+	newSample->data = data;
+	return newSample;
+}
+
+/**
+ * Open a Wav audio file to be streamed from disk.
+ * Runs on the loader thread.
+ * @param path File path.
+ * @returns The sample, or NULL if the file could not be read.
+ */
+Sample* WavPlay::streamWavFile(std::string path) {
+	Sample* newSample = new Sample();
+	newSample->stream.reset(new SampleStream());
+	if (!newSample->stream->open(path)) {
+		delete newSample;
+		return NULL;
+	}
+
+	newSample->channels = newSample->stream->channels;
+	newSample->sampleRate = newSample->stream->sampleRate;
+	newSample->frameCount = newSample->stream->frameCount;
+	newSample->fileDesc = rack::string::filename(path);
+	return newSample;
+}
+
+/**
+ * Load a file from the directory list.
+ * Runs on the loader thread.
+ * @param index Position in the directory list.
+ * @param isStreamed True to stream the file instead of decoding it.
+ * @returns The sample, or NULL if the file could not be read.
+ */
+Sample* WavPlay::loadIndexedFile(int index, bool isStreamed) {
+	if (index >= (int) listing->files.size()) {
+		return NULL;
+	}
+
+	std::string path = listing->getPath(index);
+	Sample* newSample = isStreamed ? streamWavFile(path) : decodeWavFile(path);
+	if (newSample) {
+		newSample->fileIndex = index;
+		newSample->fileCount = listing->files.size();
+		loadedPath = path;
+		loadedData = newSample->data;
+	}
+	return newSample;
+}
+
+/**
+ * Decode the files before and after a directory index into the neighbour slots.
+ * Runs on the loader thread. Samples already in the slots for the same file
+ * and engine rate are kept, so stepping back and forth doesn't decode
+ * anything again. Neighbours the sample cache evicted are streamed instead.
+ * @param index Position in the directory list of the playing file.
+ * @param isStreamed True to stream the files instead of decoding them.
+ */
+void WavPlay::prefetchNeighbours(int index, bool isStreamed) {
+	int count = listing->files.size();
+	if (count < 2 || index >= count) {
+		prefetchedIndex = index;
+		return;
+	}
+
+	// the audio thread swapped in a neighbour, watch that one for eviction
+	if (prefetchedIndex >= 0 && index != prefetchedIndex) {
+		if (index == (prefetchedIndex + 1) % count) {
+			loadedData = nextData;
+		} else if (index == (prefetchedIndex - 1 + count) % count) {
+			loadedData = prevData;
+		}
+		loadedPath = listing->getPath(index);
+	}
+	prefetchedIndex = index;
+
+	const int steps[] = {1, -1};
+	for (int step : steps) {
+		std::atomic<Sample*>& slot = step > 0 ? nextSample : prevSample;
+		int neighbourIndex = (index + step + count) % count;
+		std::weak_ptr<const SampleData>& data = step > 0 ? nextData : prevData;
+		Sample* oldSample = slot.load(std::memory_order_acquire);
+		bool isCurrentRate = oldSample && (oldSample->stream || oldSample->sampleRate == engineSampleRate);
+		std::shared_ptr<const SampleData> oldData = data.lock();
+		bool isEvicted = oldData && oldData->isEvicted;
+		oldData.reset();
+		if (oldSample && oldSample->fileIndex == neighbourIndex && isCurrentRate && !isEvicted) {
+			continue;
+		}
+
+		// the cache wants the memory of an evicted neighbour back, stream it like the playing file
+		std::string path = listing->getPath(neighbourIndex);
+		Sample* newSample = isStreamed || isEvicted ? streamWavFile(path) : decodeWavFile(path);
+		data.reset();
+		if (newSample) {
+			newSample->fileIndex = neighbourIndex;
+			newSample->fileCount = count;
+			data = newSample->data;
+		}
+
+		// the audio thread may have taken the old one meanwhile
+		delete slot.exchange(newSample, std::memory_order_acq_rel);
+	}
+}
+
+/**
+ * Check whether the sample cache evicted the data of a neighbour slot.
+ * Runs on the loader thread.
+ * @returns True if a neighbour should be replaced.
+ */
+bool WavPlay::isNeighbourEvicted() {
+	std::shared_ptr<const SampleData> next = nextData.lock();
+	std::shared_ptr<const SampleData> prev = prevData.lock();
+	return (next && next->isEvicted) || (prev && prev->isEvicted);
+}
+
+/**
+ * Check whether the loader loop has work waiting that a pyramid build holds up.
+ * Runs on the loader thread while it builds a pyramid.
+ * @returns True if a file was requested, the engine rate changed, the module
+ * is going away, or the playing file or its neighbours need loading.
+ */
+bool WavPlay::isLoaderNeeded() {
+	{
+		std::lock_guard<std::mutex> lock(loaderMutex);
+		if (loaderRequest || loaderRateChange || loaderExit) {
+			return true;
+		}
+	}
+	if (requestedIndex.load(std::memory_order_relaxed) >= 0) {
+		return true;
+	}
+	int index = playingIndex.load(std::memory_order_relaxed);
+	return index >= 0 && (index != prefetchedIndex || isNeighbourEvicted());
+}
+
+/**
+ * Look up the wav files in a file's directory.
+ * Runs on the loader thread. The directory index scans each directory only
+ * once, later loads from the same directory don't touch the disk.
+ * @param path File path.
+ */
+void WavPlay::indexDirectory(std::string path) {
+	std::string directoryName = path.empty() ? asset::user("") : rack::string::directory(path);
+	listing = DirectoryIndex::global().get(directoryName);
+	if (!listing) {
+		listing = std::make_shared<DirectoryListing>();
 	}
+	sampnumber = listing->find(rack::string::filename(path));
+	prefetchedIndex = -1;
 }
 
 /**
@@ -340,6 +982,8 @@ struct WavPlayWidget : ModuleWidget {
 		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(15.24, 65.535)), module, WavPlay::TRIGGER_INPUT));
 		addParam(createParamCentered<CKSS>(mm2px(Vec(24.0, 65.535)), module, WavPlay::TRIG_MODE_PARAM));
 		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(15.24, 87.124)), module, WavPlay::PITCH_INPUT));
+		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(6.0, 87.124)), module, WavPlay::PREV_INPUT));
+		addInput(createInputCentered<PJ301MPort>(mm2px(Vec(24.0, 87.124)), module, WavPlay::NEXT_INPUT));
 		addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(15.24, 108.713)), module, WavPlay::AUDIO_OUTPUT));
 		addChild(createLightCentered<MediumLight<RedLight>>(mm2px(Vec(15.24, 25.81)), module, WavPlay::ISPLAYING_LIGHT));
 
@@ -377,6 +1021,140 @@ struct WavPlayWidget : ModuleWidget {
 		loadWavMenuItem->text = "Load WAV file";
 		loadWavMenuItem->wavPlay = wavPlay;
 		menu->addChild(loadWavMenuItem);
+
+		// toggle between decoding into memory and streaming from disk
+		struct StreamMenuItem : MenuItem {
+			WavPlay *wavPlay;
+			void onAction(const event::Action& e) override {
+				wavPlay->isStreaming = !wavPlay->isStreaming;
+				if (!wavPlay->lastPath.empty()) {
+					wavPlay->loadWavFile(wavPlay->lastPath);
+				}
+			};
+		};
+
+		StreamMenuItem *streamMenuItem = new StreamMenuItem();
+		streamMenuItem->text = "Stream from disk";
+		streamMenuItem->rightText = CHECKMARK(wavPlay->isStreaming);
+		streamMenuItem->wavPlay = wavPlay;
+		menu->addChild(streamMenuItem);
+
+		// how frames between the stored ones are computed, more taps cost more CPU
+		struct InterpolationItem : MenuItem {
+			WavPlay *wavPlay;
+			Interpolator::Quality quality;
+			void onAction(const event::Action& e) override {
+				wavPlay->interpolation = quality;
+			};
+		};
+
+		struct InterpolationMenuItem : MenuItem {
+			WavPlay *wavPlay;
+			Menu *createChildMenu() override {
+				Menu *menu = new Menu();
+				for (int i = 0; i < Interpolator::NUM_QUALITIES; i++) {
+					Interpolator::Quality quality = static_cast<Interpolator::Quality>(i);
+					InterpolationItem *interpolationItem = new InterpolationItem();
+					interpolationItem->text = Interpolator::getQualityName(quality);
+					interpolationItem->rightText = CHECKMARK(wavPlay->interpolation == quality);
+					interpolationItem->wavPlay = wavPlay;
+					interpolationItem->quality = quality;
+					menu->addChild(interpolationItem);
+				}
+				return menu;
+			};
+		};
+
+		InterpolationMenuItem *interpolationMenuItem = new InterpolationMenuItem();
+		interpolationMenuItem->text = "Interpolation";
+		interpolationMenuItem->rightText = RIGHT_ARROW;
+		interpolationMenuItem->wavPlay = wavPlay;
+		menu->addChild(interpolationMenuItem);
+
+		// follow the pitch input at audio rate, for FM
+		struct AudioRateFmMenuItem : MenuItem {
+			WavPlay *wavPlay;
+			void onAction(const event::Action& e) override {
+				wavPlay->isAudioRateFm = !wavPlay->isAudioRateFm;
+			};
+		};
+
+		AudioRateFmMenuItem *audioRateFmMenuItem = new AudioRateFmMenuItem();
+		audioRateFmMenuItem->text = "Audio rate pitch modulation";
+		audioRateFmMenuItem->rightText = CHECKMARK(wavPlay->isAudioRateFm);
+		audioRateFmMenuItem->wavPlay = wavPlay;
+		menu->addChild(audioRateFmMenuItem);
+
+		// sample memory used by all instances against the budget
+		size_t usage = SampleCache::global().getUsage() >> 20;
+		size_t budget = SampleCache::global().getBudget() >> 20;
+		MenuLabel *memoryLabel = new MenuLabel();
+		if (budget > 0) {
+			memoryLabel->text = string::f("Sample memory: %d / %d MB", (int) usage, (int) budget);
+		} else {
+			memoryLabel->text = string::f("Sample memory: %d MB", (int) usage);
+		}
+		menu->addChild(memoryLabel);
+
+		struct BudgetItem : MenuItem {
+			size_t budget;
+			void onAction(const event::Action& e) override {
+				SampleCache::global().setBudget(budget << 20);
+				saveSettings();
+			};
+		};
+
+		struct BudgetMenuItem : MenuItem {
+			Menu *createChildMenu() override {
+				Menu *menu = new Menu();
+				const size_t budgets[] = {512, 1024, 2048, 4096, 8192, 16384, 0};
+				for (size_t budget : budgets) {
+					BudgetItem *budgetItem = new BudgetItem();
+					budgetItem->text = budget > 0 ? string::f("%d MB", (int) budget) : "Unlimited";
+					budgetItem->rightText = CHECKMARK(SampleCache::global().getBudget() == (budget << 20));
+					budgetItem->budget = budget;
+					menu->addChild(budgetItem);
+				}
+				return menu;
+			};
+		};
+
+		BudgetMenuItem *budgetMenuItem = new BudgetMenuItem();
+		budgetMenuItem->text = "Sample memory budget";
+		budgetMenuItem->rightText = RIGHT_ARROW;
+		menu->addChild(budgetMenuItem);
+
+		// how files are read from disk, applies to files opened from now on
+		struct BackendItem : MenuItem {
+			FileReader::Backend backend;
+			void onAction(const event::Action& e) override {
+				FileReader::setBackend(backend);
+				saveSettings();
+			};
+		};
+
+		struct BackendMenuItem : MenuItem {
+			Menu *createChildMenu() override {
+				Menu *menu = new Menu();
+				for (int i = 0; i < FileReader::NUM_BACKENDS; i++) {
+					FileReader::Backend backend = static_cast<FileReader::Backend>(i);
+					if (!FileReader::isAvailable(backend)) {
+						continue;
+					}
+					BackendItem *backendItem = new BackendItem();
+					backendItem->text = FileReader::getBackendName(backend);
+					backendItem->rightText = CHECKMARK(FileReader::getBackend() == backend);
+					backendItem->backend = backend;
+					menu->addChild(backendItem);
+				}
+				return menu;
+			};
+		};
+
+		BackendMenuItem *backendMenuItem = new BackendMenuItem();
+		backendMenuItem->text = "Disk reading";
+		backendMenuItem->rightText = RIGHT_ARROW;
+		menu->addChild(backendMenuItem);
 	};
 };
 
@@ -91,6 +91,10 @@
 // #define DR_WAV_NO_STDIO
 //   Disables drwav_open_file(), drwav_open_file_write(), etc.
 //
+// #define DR_WAV_NO_SIMD
+//   Disables the SSE2 and AVX2 sample conversion kernels. On x86 they are used by default, AVX2 only when the CPU
+//   supports it. They produce the same output as the scalar code, bit for bit.
+//
 //
 //
 // QUICK NOTES
@@ -201,6 +205,14 @@ typedef size_t (* drwav_write_proc)(void* pUserData, const void* pData, size_t b
 // will be either drwav_seek_origin_start or drwav_seek_origin_current.
 typedef drwav_bool32 (* drwav_seek_proc)(void* pUserData, int offset, drwav_seek_origin origin);
 
+// Callback for when data needs to be seeked to an absolute position.
+//
+// pUserData [in] The user data that was passed to drwav_init(), drwav_open() and family.
+// position  [in] The number of bytes from the start of the stream.
+//
+// Returns whether or not the seek was successful.
+typedef drwav_bool32 (* drwav_seek64_proc)(void* pUserData, drwav_uint64 position);
+
 // Structure for internal use. Only used for loaders opened with drwav_open_memory().
 typedef struct
 {
@@ -275,6 +287,11 @@ typedef struct
     // A pointer to the function to call when the wav file needs to be seeked.
     drwav_seek_proc onSeek;
 
+    // Optional. A pointer to the function to call to seek to an absolute position. When set, seeking to any sample of
+    // an uncompressed file or any block of a compressed one is a single call. The file and memory helpers set this,
+    // streams initialized with drwav_init() can set it after initialization.
+    drwav_seek64_proc onSeek64;
+
     // The user data to pass to callbacks.
     void* pUserData;
 
@@ -332,28 +349,11 @@ typedef struct
     struct
     {
         drwav_uint64 iCurrentSample;    // The index of the next sample that will be read by drwav_read_*(). This is used with "totalSampleCount" to ensure we don't read excess samples at the end of the last block.
+        drwav_uint8* pBlock;            // The raw bytes of the current block, fmt.blockAlign bytes. Allocated by drwav_init() and freed by drwav_uninit().
+        drwav_int16* pBlockSamples;     // The decoded samples of the current block. Points into the same allocation as pBlock.
+        drwav_uint64 blockSampleCount;  // The number of decoded samples in pBlockSamples.
+        drwav_uint64 iBlockSample;      // The index of the next sample in pBlockSamples that will be read by drwav_read_*().
     } compressed;
-
-    // Microsoft ADPCM specific data.
-    struct
-    {
-        drwav_uint32 bytesRemainingInBlock;
-        drwav_uint16 predictor[2];
-        drwav_int32  delta[2];
-        drwav_int32  cachedSamples[4];  // Samples are stored in this cache during decoding.
-        drwav_uint32 cachedSampleCount;
-        drwav_int32  prevSamples[2][2]; // The previous 2 samples for each channel (2 channels at most).
-    } msadpcm;
-
-    // IMA ADPCM specific data.
-    struct
-    {
-        drwav_uint32 bytesRemainingInBlock;
-        drwav_int32  predictor[2];
-        drwav_int32  stepIndex[2];
-        drwav_int32  cachedSamples[16]; // Samples are stored in this cache during decoding.
-        drwav_uint32 cachedSampleCount;
-    } ima;
 } drwav;
 
 
@@ -478,6 +478,23 @@ drwav_uint64 drwav_read(drwav* pWav, drwav_uint64 samplesToRead, void* pBufferOu
 // Returns true if successful; false otherwise.
 drwav_bool32 drwav_seek_to_sample(drwav* pWav, drwav_uint64 sample);
 
+// Retrieves the number of samples in each block of a block-compressed (ADPCM) file, counting all channels.
+//
+// Returns 0 if the file is not block-compressed.
+drwav_uint64 drwav_samples_per_block(const drwav* pWav);
+
+// Decodes a single block of an MS-ADPCM or IMA ADPCM file to signed 16-bit PCM samples.
+//
+// <pBlock> points to the raw bytes of the block as read with drwav_read_raw(), normally fmt.blockAlign bytes. The last
+// block of a file may be shorter, in which case only the complete samples it holds are decoded. <pBufferOut> must have
+// room for drwav_samples_per_block() samples.
+//
+// Every block carries its own decoder state, so blocks can be decoded in any order. This does not touch the decoding
+// state of <pWav>, which makes it safe to decode different blocks of the same file on different threads.
+//
+// Returns the number of samples decoded.
+drwav_uint64 drwav_decode_block_s16(const drwav* pWav, const void* pBlock, size_t blockSize, drwav_int16* pBufferOut);
+
 
 // Writes raw audio data.
 //
@@ -530,6 +547,12 @@ void drwav_mulaw_to_s16(drwav_int16* pOut, const drwav_uint8* pIn, size_t sample
 // If the return value is less than <samplesToRead> it means the end of the file has been reached.
 drwav_uint64 drwav_read_f32(drwav* pWav, drwav_uint64 samplesToRead, float* pBufferOut);
 
+// Reads a number of PCM frames, converts them to IEEE 32-bit floating point and writes each channel to its own array.
+//
+// <ppChannelsOut> points to one output array per channel, each with room for <framesToRead> samples. Returns the number
+// of whole frames actually read, which is less than <framesToRead> at the end of the file.
+drwav_uint64 drwav_read_f32_deinterleaved(drwav* pWav, drwav_uint64 framesToRead, float** ppChannelsOut);
+
 // Low-level function for converting unsigned 8-bit PCM samples to IEEE 32-bit floating point samples.
 void drwav_u8_to_f32(float* pOut, const drwav_uint8* pIn, size_t sampleCount);
 
@@ -580,6 +603,20 @@ void drwav_alaw_to_s32(drwav_int32* pOut, const drwav_uint8* pIn, size_t sampleC
 // Low-level function for converting u-law samples to signed 32-bit PCM samples.
 void drwav_mulaw_to_s32(drwav_int32* pOut, const drwav_uint8* pIn, size_t sampleCount);
 
+
+// Low-level functions for converting IEEE 32-bit floating point samples to signed PCM samples for writing.
+//
+// Samples are scaled by 32768, 8388608 or 2147483648 (the inverse of the conversions to floating point), rounded to the
+// nearest integer and clipped to the range of the output type. NaNs become 0. The 24-bit version outputs packed 3-byte
+// little-endian samples, ready for drwav_write() with 24 bits per sample.
+//
+// If <pDitherSeed> is not NULL, triangular (TPDF) dither of up to +/-1 LSB is added before rounding. The noise depends
+// only on the seed and the position of the sample, and the seed is advanced past the converted samples, so converting a
+// stream in pieces gives the same output as converting it in one go. The seed can start at any value.
+void drwav_f32_to_s16_clipped(drwav_int16* pOut, const float* pIn, size_t sampleCount, drwav_uint32* pDitherSeed);
+void drwav_f32_to_s24_clipped(drwav_uint8* pOut, const float* pIn, size_t sampleCount, drwav_uint32* pDitherSeed);
+void drwav_f32_to_s32_clipped(drwav_int32* pOut, const float* pIn, size_t sampleCount, drwav_uint32* pDitherSeed);
+
 #endif  //DR_WAV_NO_CONVERSION_API
 
 
@@ -691,6 +728,7 @@ void drwav_free(void* pDataReturnedByOpenAndRead);
 #include <stdlib.h>
 #include <string.h> // For memcpy(), memset()
 #include <limits.h> // For INT_MAX
+#include <math.h>   // For lrintf()
 
 #ifndef DR_WAV_NO_STDIO
 #include <stdio.h>
@@ -730,6 +768,23 @@ void drwav_free(void* pDataReturnedByOpenAndRead);
 
 #define DRWAV_MAX_SIMD_VECTOR_SIZE         64  // 64 for AVX-512 in the future.
 
+// SIMD. SSE2 is part of every x86-64 CPU. AVX2 kernels are compiled for AVX2 on their own, without changing the
+// compiler flags of the whole file, and are only called after checking the CPU with CPUID.
+#if !defined(DR_WAV_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64) || ((defined(__i386__) || defined(_M_IX86)) && defined(__SSE2__)))
+    #define DRWAV_SUPPORT_SSE2
+    #include <emmintrin.h>
+    #if defined(_MSC_VER) && _MSC_VER >= 1800
+        #define DRWAV_SUPPORT_AVX2
+        #define DRWAV_TARGET_AVX2
+        #include <immintrin.h>
+        #include <intrin.h>
+    #elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+        #define DRWAV_SUPPORT_AVX2
+        #define DRWAV_TARGET_AVX2 __attribute__((target("avx2")))
+        #include <immintrin.h>
+    #endif
+#endif
+
 #ifdef _MSC_VER
 #define DRWAV_INLINE __forceinline
 #else
@@ -1050,6 +1105,20 @@ static drwav_bool32 drwav__on_seek_stdio(void* pUserData, int offset, drwav_seek
     return fseek((FILE*)pUserData, offset, (origin == drwav_seek_origin_current) ? SEEK_CUR : SEEK_SET) == 0;
 }
 
+static drwav_bool32 drwav__on_seek64_stdio(void* pUserData, drwav_uint64 position)
+{
+#if defined(_WIN32)
+    return _fseeki64((FILE*)pUserData, (__int64)position, SEEK_SET) == 0;
+#elif defined(__APPLE__) || defined(_LARGEFILE_SOURCE) || (defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200112L)
+    return fseeko((FILE*)pUserData, (off_t)position, SEEK_SET) == 0;
+#else
+    if (position > LONG_MAX) {
+        return DRWAV_FALSE;
+    }
+    return fseek((FILE*)pUserData, (long)position, SEEK_SET) == 0;
+#endif
+}
+
 drwav_bool32 drwav_init_file(drwav* pWav, const char* filename)
 {
     FILE* pFile = drwav_fopen(filename, "rb");
@@ -1057,7 +1126,12 @@ drwav_bool32 drwav_init_file(drwav* pWav, const char* filename)
         return DRWAV_FALSE;
     }
 
-    return drwav_init(pWav, drwav__on_read_stdio, drwav__on_seek_stdio, (void*)pFile);
+    if (!drwav_init(pWav, drwav__on_read_stdio, drwav__on_seek_stdio, (void*)pFile)) {
+        return DRWAV_FALSE;
+    }
+
+    pWav->onSeek64 = drwav__on_seek64_stdio;
+    return DRWAV_TRUE;
 }
 
 
@@ -1094,6 +1168,7 @@ drwav* drwav_open_file(const char* filename)
         return NULL;
     }
 
+    pWav->onSeek64 = drwav__on_seek64_stdio;
     return pWav;
 }
 
@@ -1145,6 +1220,19 @@ static size_t drwav__on_read_memory(void* pUserData, void* pBufferOut, size_t by
     return bytesToRead;
 }
 
+static drwav_bool32 drwav__on_seek64_memory(void* pUserData, drwav_uint64 position)
+{
+    drwav__memory_stream* memory = (drwav__memory_stream*)pUserData;
+    drwav_assert(memory != NULL);
+
+    if (position > memory->dataSize) {
+        return DRWAV_FALSE;
+    }
+
+    memory->currentReadPos = (size_t)position;
+    return DRWAV_TRUE;
+}
+
 static drwav_bool32 drwav__on_seek_memory(void* pUserData, int offset, drwav_seek_origin origin)
 {
     drwav__memory_stream* memory = (drwav__memory_stream*)pUserData;
@@ -1259,6 +1347,7 @@ drwav_bool32 drwav_init_memory(drwav* pWav, const void* data, size_t dataSize)
 
     pWav->memoryStream = memoryStream;
     pWav->pUserData = &pWav->memoryStream;
+    pWav->onSeek64 = drwav__on_seek64_memory;
     return DRWAV_TRUE;
 }
 
@@ -1319,6 +1408,7 @@ drwav* drwav_open_memory(const void* data, size_t dataSize)
 
     pWav->memoryStream = memoryStream;
     pWav->pUserData = &pWav->memoryStream;
+    pWav->onSeek64 = drwav__on_seek64_memory;
     return pWav;
 }
 
@@ -1585,6 +1675,17 @@ drwav_bool32 drwav_init(drwav* pWav, drwav_read_proc onRead, drwav_seek_proc onS
     }
 #endif
 
+    // Block-compressed formats are decoded a whole block at a time.
+    drwav_uint64 samplesPerBlock = drwav_samples_per_block(pWav);
+    if (samplesPerBlock > 0) {
+        size_t blockBufferSize = (((size_t)fmt.blockAlign + 1) & ~(size_t)1) + (size_t)samplesPerBlock*sizeof(drwav_int16);
+        pWav->compressed.pBlock = (drwav_uint8*)DRWAV_MALLOC(blockBufferSize);
+        if (pWav->compressed.pBlock == NULL) {
+            return DRWAV_FALSE;
+        }
+        pWav->compressed.pBlockSamples = (drwav_int16*)(pWav->compressed.pBlock + ((fmt.blockAlign + 1) & ~1));
+    }
+
     return DRWAV_TRUE;
 }
 
@@ -1825,6 +1926,9 @@ void drwav_uninit(drwav* pWav)
         fclose((FILE*)pWav->pUserData);
     }
 #endif
+
+    DRWAV_FREE(pWav->compressed.pBlock);
+    pWav->compressed.pBlock = NULL;
 }
 
 
@@ -1912,18 +2016,85 @@ drwav_uint64 drwav_read(drwav* pWav, drwav_uint64 samplesToRead, void* pBufferOu
     return bytesRead / pWav->bytesPerSample;
 }
 
+// ADPCM blocks always have the same size and start with a header that holds the decoder state, so any block can be
+// decoded on its own.
+drwav_uint64 drwav_samples_per_block(const drwav* pWav)
+{
+    if (pWav == NULL) {
+        return 0;
+    }
+
+    if (pWav->translatedFormatTag == DR_WAVE_FORMAT_ADPCM) {
+        if (pWav->fmt.blockAlign <= 7*pWav->channels) {
+            return 0;
+        }
+        return (pWav->fmt.blockAlign - (6*pWav->channels)) * 2;   // 2 samples in the header and 2 per byte after it.
+    }
+    if (pWav->translatedFormatTag == DR_WAVE_FORMAT_DVI_ADPCM) {
+        if (pWav->fmt.blockAlign <= 4*pWav->channels) {
+            return 0;
+        }
+        return ((pWav->fmt.blockAlign - (4*pWav->channels)) * 2) + pWav->channels;  // 1 sample in the header and 2 per byte after it.
+    }
+    return 0;
+}
+
+// Drops whatever is left of the current block, the next read starts by loading a new block.
+static void drwav__reset_compressed_block(drwav* pWav)
+{
+    pWav->compressed.blockSampleCount = 0;
+    pWav->compressed.iBlockSample = 0;
+}
+
+// Moves to a byte offset within the data chunk. With an absolute seek callback this is a single call. Otherwise it seeks
+// forward from the current position, going back to the start of the data first if the offset is behind it.
+static drwav_bool32 drwav__seek_to_data_offset(drwav* pWav, drwav_uint64 offset)
+{
+    if (offset == pWav->dataChunkDataSize - pWav->bytesRemaining) {
+        return DRWAV_TRUE;  // Already there.
+    }
+
+    if (pWav->onSeek64 != NULL) {
+        if (!pWav->onSeek64(pWav->pUserData, pWav->dataChunkDataPos + offset)) {
+            return DRWAV_FALSE;
+        }
+    } else {
+        drwav_uint64 currentOffset = pWav->dataChunkDataSize - pWav->bytesRemaining;
+        if (offset < currentOffset) {
+            if (!pWav->onSeek(pWav->pUserData, (int)pWav->dataChunkDataPos, drwav_seek_origin_start)) {
+                return DRWAV_FALSE;
+            }
+            currentOffset = 0;
+        }
+
+        if (!drwav__seek_forward(pWav->onSeek, offset - currentOffset, pWav->pUserData)) {
+            return DRWAV_FALSE;
+        }
+    }
+
+    pWav->bytesRemaining = pWav->dataChunkDataSize - offset;
+    return DRWAV_TRUE;
+}
+
 drwav_bool32 drwav_seek_to_first_sample(drwav* pWav)
 {
     if (pWav->onWrite != NULL) {
         return DRWAV_FALSE; // No seeking in write mode.
     }
 
-    if (!pWav->onSeek(pWav->pUserData, (int)pWav->dataChunkDataPos, drwav_seek_origin_start)) {
-        return DRWAV_FALSE;
+    if (pWav->onSeek64 != NULL) {
+        if (!pWav->onSeek64(pWav->pUserData, pWav->dataChunkDataPos)) {
+            return DRWAV_FALSE;
+        }
+    } else {
+        if (!pWav->onSeek(pWav->pUserData, (int)pWav->dataChunkDataPos, drwav_seek_origin_start)) {
+            return DRWAV_FALSE;
+        }
     }
 
     if (drwav__is_compressed_format_tag(pWav->translatedFormatTag)) {
         pWav->compressed.iCurrentSample = 0;
+        drwav__reset_compressed_block(pWav);
     }
 
     pWav->bytesRemaining = pWav->dataChunkDataSize;
@@ -1953,14 +2124,21 @@ drwav_bool32 drwav_seek_to_sample(drwav* pWav, drwav_uint64 sample)
     }
 
 
-    // For compressed formats we just use a slow generic seek. If we are seeking forward we just seek forward. If we are going backwards we need
-    // to seek back to the start.
+    // For compressed formats we jump to the start of the block holding the sample, unless we're already in it, and then decode up to the
+    // sample. Formats without fixed size blocks fall back to seeking back to the start.
     if (drwav__is_compressed_format_tag(pWav->translatedFormatTag)) {
-        // TODO: This can be optimized.
+        drwav_uint64 samplesPerBlock = drwav_samples_per_block(pWav);
+        if (samplesPerBlock > 0) {
+            drwav_uint64 iBlock = sample / samplesPerBlock;
+            if (sample < pWav->compressed.iCurrentSample || iBlock != pWav->compressed.iCurrentSample / samplesPerBlock) {
+                if (!drwav__seek_to_data_offset(pWav, iBlock * pWav->fmt.blockAlign)) {
+                    return DRWAV_FALSE;
+                }
 
-        // If we're seeking forward it's simple - just keep reading samples until we hit the sample we're requesting. If we're seeking backwards,
-        // we first need to seek back to the start and then just do the same thing as a forward seek.
-        if (sample < pWav->compressed.iCurrentSample) {
+                pWav->compressed.iCurrentSample = iBlock * samplesPerBlock;
+                drwav__reset_compressed_block(pWav);
+            }
+        } else if (sample < pWav->compressed.iCurrentSample) {
             if (!drwav_seek_to_first_sample(pWav)) {
                 return DRWAV_FALSE;
             }
@@ -1993,32 +2171,8 @@ drwav_bool32 drwav_seek_to_sample(drwav* pWav, drwav_uint64 sample)
             }
         }
     } else {
-        drwav_uint64 totalSizeInBytes = pWav->totalSampleCount * pWav->bytesPerSample;
-        drwav_assert(totalSizeInBytes >= pWav->bytesRemaining);
-
-        drwav_uint64 currentBytePos = totalSizeInBytes - pWav->bytesRemaining;
-        drwav_uint64 targetBytePos  = sample * pWav->bytesPerSample;
-
-        drwav_uint64 offset;
-        if (currentBytePos < targetBytePos) {
-            // Offset forwards.
-            offset = (targetBytePos - currentBytePos);
-        } else {
-            // Offset backwards.
-            if (!drwav_seek_to_first_sample(pWav)) {
-                return DRWAV_FALSE;
-            }
-            offset = targetBytePos;
-        }
-
-        while (offset > 0) {
-            int offset32 = ((offset > INT_MAX) ? INT_MAX : (int)offset);
-            if (!pWav->onSeek(pWav->pUserData, offset32, drwav_seek_origin_current)) {
-                return DRWAV_FALSE;
-            }
-
-            pWav->bytesRemaining -= offset32;
-            offset -= offset32;
+        if (!drwav__seek_to_data_offset(pWav, sample * pWav->bytesPerSample)) {
+            return DRWAV_FALSE;
         }
     }
 
@@ -2072,346 +2226,294 @@ drwav_uint64 drwav_write(drwav* pWav, drwav_uint64 samplesToWrite, const void* p
 
 
 
-drwav_uint64 drwav_read_s16__msadpcm(drwav* pWav, drwav_uint64 samplesToRead, drwav_int16* pBufferOut)
-{
-    drwav_assert(pWav != NULL);
-    drwav_assert(samplesToRead > 0);
-    drwav_assert(pBufferOut != NULL);
-
-    // TODO: Lots of room for optimization here.
-
-    drwav_uint64 totalSamplesRead = 0;
-
-    while (samplesToRead > 0 && pWav->compressed.iCurrentSample < pWav->totalSampleCount) {
-        // If there are no cached samples we need to load a new block.
-        if (pWav->msadpcm.cachedSampleCount == 0 && pWav->msadpcm.bytesRemainingInBlock == 0) {
-            if (pWav->channels == 1) {
-                // Mono.
-                drwav_uint8 header[7];
-                if (pWav->onRead(pWav->pUserData, header, sizeof(header)) != sizeof(header)) {
-                    return totalSamplesRead;
-                }
-                pWav->msadpcm.bytesRemainingInBlock = pWav->fmt.blockAlign - sizeof(header);
-
-                pWav->msadpcm.predictor[0] = header[0];
-                pWav->msadpcm.delta[0] = drwav__bytes_to_s16(header + 1);
-                pWav->msadpcm.prevSamples[0][1] = (drwav_int32)drwav__bytes_to_s16(header + 3);
-                pWav->msadpcm.prevSamples[0][0] = (drwav_int32)drwav__bytes_to_s16(header + 5);
-                pWav->msadpcm.cachedSamples[2] = pWav->msadpcm.prevSamples[0][0];
-                pWav->msadpcm.cachedSamples[3] = pWav->msadpcm.prevSamples[0][1];
-                pWav->msadpcm.cachedSampleCount = 2;
-            } else {
-                // Stereo.
-                drwav_uint8 header[14];
-                if (pWav->onRead(pWav->pUserData, header, sizeof(header)) != sizeof(header)) {
-                    return totalSamplesRead;
-                }
-                pWav->msadpcm.bytesRemainingInBlock = pWav->fmt.blockAlign - sizeof(header);
-
-                pWav->msadpcm.predictor[0] = header[0];
-                pWav->msadpcm.predictor[1] = header[1];
-                pWav->msadpcm.delta[0] = drwav__bytes_to_s16(header + 2);
-                pWav->msadpcm.delta[1] = drwav__bytes_to_s16(header + 4);
-                pWav->msadpcm.prevSamples[0][1] = (drwav_int32)drwav__bytes_to_s16(header + 6);
-                pWav->msadpcm.prevSamples[1][1] = (drwav_int32)drwav__bytes_to_s16(header + 8);
-                pWav->msadpcm.prevSamples[0][0] = (drwav_int32)drwav__bytes_to_s16(header + 10);
-                pWav->msadpcm.prevSamples[1][0] = (drwav_int32)drwav__bytes_to_s16(header + 12);
-
-                pWav->msadpcm.cachedSamples[0] = pWav->msadpcm.prevSamples[0][0];
-                pWav->msadpcm.cachedSamples[1] = pWav->msadpcm.prevSamples[1][0];
-                pWav->msadpcm.cachedSamples[2] = pWav->msadpcm.prevSamples[0][1];
-                pWav->msadpcm.cachedSamples[3] = pWav->msadpcm.prevSamples[1][1];
-                pWav->msadpcm.cachedSampleCount = 4;
-            }
-        }
-
-        // Output anything that's cached.
-        while (samplesToRead > 0 && pWav->msadpcm.cachedSampleCount > 0 && pWav->compressed.iCurrentSample < pWav->totalSampleCount) {
-            pBufferOut[0] = (drwav_int16)pWav->msadpcm.cachedSamples[drwav_countof(pWav->msadpcm.cachedSamples) - pWav->msadpcm.cachedSampleCount];
-            pWav->msadpcm.cachedSampleCount -= 1;
+static const drwav_int32 drwav__msadpcm_adaptation_table[16] = {
+    230, 230, 230, 230, 307, 409, 512, 614,
+    768, 614, 512, 409, 307, 230, 230, 230
+};
+static const drwav_int32 drwav__msadpcm_coeff1_table[7] = { 256, 512, 0, 192, 240, 460,  392 };
+static const drwav_int32 drwav__msadpcm_coeff2_table[7] = { 0,  -256, 0, 64,  0,  -208, -232 };
 
-            pBufferOut += 1;
-            samplesToRead -= 1;
-            totalSamplesRead += 1;
-            pWav->compressed.iCurrentSample += 1;
-        }
+static const drwav_int32 drwav__ima_index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
 
-        if (samplesToRead == 0) {
-            return totalSamplesRead;
-        }
+static const drwav_int32 drwav__ima_step_table[89] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,
+    19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
+    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+    130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
+    337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
+    876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+    2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
+    5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
 
+// Decodes one MS-ADPCM nibble. <nibble> is the raw 4-bit code. prevSamples[0] is the older of the two previous samples.
+static DRWAV_INLINE drwav_int32 drwav__msadpcm_decode_nibble(drwav_uint8 nibble, drwav_int32 coeff1, drwav_int32 coeff2, drwav_int32* pDelta, drwav_int32* prevSamples)
+{
+    drwav_int32 signedNibble = (drwav_int32)(nibble ^ 0x08) - 0x08;
 
-        // If there's nothing left in the cache, just go ahead and load more. If there's nothing left to load in the current block we just continue to the next
-        // loop iteration which will trigger the loading of a new block.
-        if (pWav->msadpcm.cachedSampleCount == 0) {
-            if (pWav->msadpcm.bytesRemainingInBlock == 0) {
-                continue;
-            } else {
-                drwav_uint8 nibbles;
-                if (pWav->onRead(pWav->pUserData, &nibbles, 1) != 1) {
-                    return totalSamplesRead;
-                }
-                pWav->msadpcm.bytesRemainingInBlock -= 1;
+    drwav_int32 newSample;
+    newSample  = ((prevSamples[1] * coeff1) + (prevSamples[0] * coeff2)) >> 8;
+    newSample += signedNibble * *pDelta;
+    newSample  = drwav_clamp(newSample, -32768, 32767);
 
-                // TODO: Optimize away these if statements.
-                drwav_int32 nibble0 = ((nibbles & 0xF0) >> 4); if ((nibbles & 0x80)) { nibble0 |= 0xFFFFFFF0UL; }
-                drwav_int32 nibble1 = ((nibbles & 0x0F) >> 0); if ((nibbles & 0x08)) { nibble1 |= 0xFFFFFFF0UL; }
+    // Corrupt blocks can grow the delta without bound, so it's capped where the next multiplication would overflow.
+    *pDelta = (drwav__msadpcm_adaptation_table[nibble] * *pDelta) >> 8;
+    *pDelta = drwav_clamp(*pDelta, 16, 0x7FFFFFFF / 768);
 
-                static drwav_int32 adaptationTable[] = {
-                    230, 230, 230, 230, 307, 409, 512, 614,
-                    768, 614, 512, 409, 307, 230, 230, 230
-                };
-                static drwav_int32 coeff1Table[] = { 256, 512, 0, 192, 240, 460,  392 };
-                static drwav_int32 coeff2Table[] = { 0,  -256, 0, 64,  0,  -208, -232 };
+    prevSamples[0] = prevSamples[1];
+    prevSamples[1] = newSample;
+    return newSample;
+}
 
-                if (pWav->channels == 1) {
-                    // Mono.
-                    drwav_int32 newSample0;
-                    newSample0  = ((pWav->msadpcm.prevSamples[0][1] * coeff1Table[pWav->msadpcm.predictor[0]]) + (pWav->msadpcm.prevSamples[0][0] * coeff2Table[pWav->msadpcm.predictor[0]])) >> 8;
-                    newSample0 += nibble0 * pWav->msadpcm.delta[0];
-                    newSample0  = drwav_clamp(newSample0, -32768, 32767);
+// Decodes one IMA ADPCM nibble.
+static DRWAV_INLINE drwav_int32 drwav__ima_decode_nibble(drwav_uint8 nibble, drwav_int32* pPredictor, drwav_int32* pStepIndex)
+{
+    drwav_int32 step = drwav__ima_step_table[*pStepIndex];
 
-                    pWav->msadpcm.delta[0] = (adaptationTable[((nibbles & 0xF0) >> 4)] * pWav->msadpcm.delta[0]) >> 8;
-                    if (pWav->msadpcm.delta[0] < 16) {
-                        pWav->msadpcm.delta[0] = 16;
-                    }
+    // The nibble bits are close to random, so this is done with masks rather than branches.
+    drwav_int32 diff = step >> 3;
+    diff += (step >> 2) & -(drwav_int32)((nibble >> 0) & 1);
+    diff += (step >> 1) & -(drwav_int32)((nibble >> 1) & 1);
+    diff += (step >> 0) & -(drwav_int32)((nibble >> 2) & 1);
 
-                    pWav->msadpcm.prevSamples[0][0] = pWav->msadpcm.prevSamples[0][1];
-                    pWav->msadpcm.prevSamples[0][1] = newSample0;
+    drwav_int32 sign = -(drwav_int32)((nibble >> 3) & 1);
+    diff = (diff ^ sign) - sign;
 
+    *pPredictor = drwav_clamp(*pPredictor + diff, -32768, 32767);
+    *pStepIndex = drwav_clamp(*pStepIndex + drwav__ima_index_table[nibble], 0, (drwav_int32)drwav_countof(drwav__ima_step_table)-1);
+    return *pPredictor;
+}
 
-                    drwav_int32 newSample1;
-                    newSample1  = ((pWav->msadpcm.prevSamples[0][1] * coeff1Table[pWav->msadpcm.predictor[0]]) + (pWav->msadpcm.prevSamples[0][0] * coeff2Table[pWav->msadpcm.predictor[0]])) >> 8;
-                    newSample1 += nibble1 * pWav->msadpcm.delta[0];
-                    newSample1  = drwav_clamp(newSample1, -32768, 32767);
+static drwav_uint64 drwav__decode_block_s16__msadpcm(drwav_uint32 channels, const drwav_uint8* pBlock, size_t blockSize, drwav_int16* pBufferOut)
+{
+    drwav_assert(channels == 1 || channels == 2);
 
-                    pWav->msadpcm.delta[0] = (adaptationTable[((nibbles & 0x0F) >> 0)] * pWav->msadpcm.delta[0]) >> 8;
-                    if (pWav->msadpcm.delta[0] < 16) {
-                        pWav->msadpcm.delta[0] = 16;
-                    }
+    size_t headerSize = 7*channels;
+    if (blockSize < headerSize) {
+        return 0;
+    }
 
-                    pWav->msadpcm.prevSamples[0][0] = pWav->msadpcm.prevSamples[0][1];
-                    pWav->msadpcm.prevSamples[0][1] = newSample1;
+    // The header holds the predictor and delta of each channel followed by the two previous samples, newest first.
+    // Out of range predictors are clamped so a corrupt block can't read outside the coefficient tables.
+    drwav_int32 coeff1[2];
+    drwav_int32 coeff2[2];
+    drwav_int32 delta[2];
+    drwav_int32 prevSamples[2][2];
+    for (drwav_uint32 iChannel = 0; iChannel < channels; ++iChannel) {
+        drwav_uint8 predictor = drwav_min(pBlock[iChannel], 6);
+        coeff1[iChannel] = drwav__msadpcm_coeff1_table[predictor];
+        coeff2[iChannel] = drwav__msadpcm_coeff2_table[predictor];
+        delta[iChannel]  = drwav__bytes_to_s16(pBlock + channels   + iChannel*2);
+        prevSamples[iChannel][1] = drwav__bytes_to_s16(pBlock + channels*3 + iChannel*2);
+        prevSamples[iChannel][0] = drwav__bytes_to_s16(pBlock + channels*5 + iChannel*2);
+    }
 
+    drwav_uint64 samplesDecoded = 0;
+    for (drwav_uint32 iChannel = 0; iChannel < channels; ++iChannel) {
+        pBufferOut[samplesDecoded++] = (drwav_int16)prevSamples[iChannel][0];
+    }
+    for (drwav_uint32 iChannel = 0; iChannel < channels; ++iChannel) {
+        pBufferOut[samplesDecoded++] = (drwav_int16)prevSamples[iChannel][1];
+    }
 
-                    pWav->msadpcm.cachedSamples[2] = newSample0;
-                    pWav->msadpcm.cachedSamples[3] = newSample1;
-                    pWav->msadpcm.cachedSampleCount = 2;
-                } else {
-                    // Stereo.
+    // Each byte holds two samples, high nibble first. With stereo the high nibble is the left channel and the low nibble
+    // the right channel, with mono both belong to the same channel.
+    drwav_uint32 iLast = channels - 1;
+    for (size_t iByte = headerSize; iByte < blockSize; ++iByte) {
+        drwav_uint8 nibbles = pBlock[iByte];
+        pBufferOut[samplesDecoded++] = (drwav_int16)drwav__msadpcm_decode_nibble((nibbles & 0xF0) >> 4, coeff1[0],     coeff2[0],     &delta[0],     prevSamples[0]);
+        pBufferOut[samplesDecoded++] = (drwav_int16)drwav__msadpcm_decode_nibble((nibbles & 0x0F) >> 0, coeff1[iLast], coeff2[iLast], &delta[iLast], prevSamples[iLast]);
+    }
 
-                    // Left.
-                    drwav_int32 newSample0;
-                    newSample0  = ((pWav->msadpcm.prevSamples[0][1] * coeff1Table[pWav->msadpcm.predictor[0]]) + (pWav->msadpcm.prevSamples[0][0] * coeff2Table[pWav->msadpcm.predictor[0]])) >> 8;
-                    newSample0 += nibble0 * pWav->msadpcm.delta[0];
-                    newSample0  = drwav_clamp(newSample0, -32768, 32767);
+    return samplesDecoded;
+}
 
-                    pWav->msadpcm.delta[0] = (adaptationTable[((nibbles & 0xF0) >> 4)] * pWav->msadpcm.delta[0]) >> 8;
-                    if (pWav->msadpcm.delta[0] < 16) {
-                        pWav->msadpcm.delta[0] = 16;
-                    }
+static drwav_uint64 drwav__decode_block_s16__ima(drwav_uint32 channels, const drwav_uint8* pBlock, size_t blockSize, drwav_int16* pBufferOut)
+{
+    drwav_assert(channels == 1 || channels == 2);
 
-                    pWav->msadpcm.prevSamples[0][0] = pWav->msadpcm.prevSamples[0][1];
-                    pWav->msadpcm.prevSamples[0][1] = newSample0;
+    size_t headerSize = 4*channels;
+    if (blockSize < headerSize) {
+        return 0;
+    }
 
+    // The header holds the first sample and the step index of each channel.
+    drwav_int32 predictor[2];
+    drwav_int32 stepIndex[2];
+    for (drwav_uint32 iChannel = 0; iChannel < channels; ++iChannel) {
+        predictor[iChannel] = drwav__bytes_to_s16(pBlock + iChannel*4);
+        stepIndex[iChannel] = drwav_min(pBlock[iChannel*4 + 2], (drwav_int32)drwav_countof(drwav__ima_step_table)-1);
+        pBufferOut[iChannel] = (drwav_int16)predictor[iChannel];
+    }
+
+    // Every 4 bytes (8 samples) belong to one channel, alternating between channels, low nibble first.
+    drwav_int16* pRunningBufferOut = pBufferOut + channels;
+    size_t groupSize = 4*channels;
+    size_t groupCount = (blockSize - headerSize) / groupSize;
+    for (size_t iGroup = 0; iGroup < groupCount; ++iGroup) {
+        const drwav_uint8* pGroup = pBlock + headerSize + iGroup*groupSize;
+        for (drwav_uint32 iChannel = 0; iChannel < channels; ++iChannel) {
+            for (drwav_uint32 iByte = 0; iByte < 4; ++iByte) {
+                drwav_uint8 nibbles = pGroup[iChannel*4 + iByte];
+                pRunningBufferOut[(iByte*2+0)*channels + iChannel] = (drwav_int16)drwav__ima_decode_nibble((nibbles & 0x0F) >> 0, &predictor[iChannel], &stepIndex[iChannel]);
+                pRunningBufferOut[(iByte*2+1)*channels + iChannel] = (drwav_int16)drwav__ima_decode_nibble((nibbles & 0xF0) >> 4, &predictor[iChannel], &stepIndex[iChannel]);
+            }
+        }
+        pRunningBufferOut += 8*channels;
+    }
 
-                    // Right.
-                    drwav_int32 newSample1;
-                    newSample1  = ((pWav->msadpcm.prevSamples[1][1] * coeff1Table[pWav->msadpcm.predictor[1]]) + (pWav->msadpcm.prevSamples[1][0] * coeff2Table[pWav->msadpcm.predictor[1]])) >> 8;
-                    newSample1 += nibble1 * pWav->msadpcm.delta[1];
-                    newSample1  = drwav_clamp(newSample1, -32768, 32767);
+    return (drwav_uint64)(pRunningBufferOut - pBufferOut);
+}
 
-                    pWav->msadpcm.delta[1] = (adaptationTable[((nibbles & 0x0F) >> 0)] * pWav->msadpcm.delta[1]) >> 8;
-                    if (pWav->msadpcm.delta[1] < 16) {
-                        pWav->msadpcm.delta[1] = 16;
-                    }
+drwav_uint64 drwav_decode_block_s16(const drwav* pWav, const void* pBlock, size_t blockSize, drwav_int16* pBufferOut)
+{
+    if (pWav == NULL || pBlock == NULL || pBufferOut == NULL) {
+        return 0;
+    }
 
-                    pWav->msadpcm.prevSamples[1][0] = pWav->msadpcm.prevSamples[1][1];
-                    pWav->msadpcm.prevSamples[1][1] = newSample1;
+    if (blockSize > pWav->fmt.blockAlign) {
+        blockSize = pWav->fmt.blockAlign;
+    }
 
-                    pWav->msadpcm.cachedSamples[2] = newSample0;
-                    pWav->msadpcm.cachedSamples[3] = newSample1;
-                    pWav->msadpcm.cachedSampleCount = 2;
-                }
-            }
-        }
+    if (pWav->translatedFormatTag == DR_WAVE_FORMAT_ADPCM) {
+        return drwav__decode_block_s16__msadpcm(pWav->channels, (const drwav_uint8*)pBlock, blockSize, pBufferOut);
+    }
+    if (pWav->translatedFormatTag == DR_WAVE_FORMAT_DVI_ADPCM) {
+        return drwav__decode_block_s16__ima(pWav->channels, (const drwav_uint8*)pBlock, blockSize, pBufferOut);
     }
 
-    return totalSamplesRead;
+    return 0;
 }
 
-drwav_uint64 drwav_read_s16__ima(drwav* pWav, drwav_uint64 samplesToRead, drwav_int16* pBufferOut)
+// Reads block-compressed samples a block at a time. Whole blocks that fit in the output buffer are decoded straight into it,
+// anything else goes through the decoded copy of the current block.
+static drwav_uint64 drwav_read_s16__compressed(drwav* pWav, drwav_uint64 samplesToRead, drwav_int16* pBufferOut)
 {
     drwav_assert(pWav != NULL);
     drwav_assert(samplesToRead > 0);
     drwav_assert(pBufferOut != NULL);
+    drwav_assert(pWav->compressed.pBlock != NULL);
 
-    // TODO: Lots of room for optimization here.
-
+    drwav_uint64 samplesPerBlock = drwav_samples_per_block(pWav);
     drwav_uint64 totalSamplesRead = 0;
 
     while (samplesToRead > 0 && pWav->compressed.iCurrentSample < pWav->totalSampleCount) {
-        // If there are no cached samples we need to load a new block.
-        if (pWav->ima.cachedSampleCount == 0 && pWav->ima.bytesRemainingInBlock == 0) {
-            if (pWav->channels == 1) {
-                // Mono.
-                drwav_uint8 header[4];
-                if (pWav->onRead(pWav->pUserData, header, sizeof(header)) != sizeof(header)) {
-                    return totalSamplesRead;
-                }
-                pWav->ima.bytesRemainingInBlock = pWav->fmt.blockAlign - sizeof(header);
+        drwav_uint64 samplesRemaining = pWav->totalSampleCount - pWav->compressed.iCurrentSample;
+        if (samplesToRead < samplesRemaining) {
+            samplesRemaining = samplesToRead;
+        }
 
-                pWav->ima.predictor[0] = drwav__bytes_to_s16(header + 0);
-                pWav->ima.stepIndex[0] = header[2];
-                pWav->ima.cachedSamples[drwav_countof(pWav->ima.cachedSamples) - 1] = pWav->ima.predictor[0];
-                pWav->ima.cachedSampleCount = 1;
-            } else {
-                // Stereo.
-                drwav_uint8 header[8];
-                if (pWav->onRead(pWav->pUserData, header, sizeof(header)) != sizeof(header)) {
-                    return totalSamplesRead;
-                }
-                pWav->ima.bytesRemainingInBlock = pWav->fmt.blockAlign - sizeof(header);
+        // If there's nothing left of the current block we need to load a new one.
+        if (pWav->compressed.iBlockSample == pWav->compressed.blockSampleCount) {
+            size_t bytesToRead = pWav->fmt.blockAlign;
+            if (bytesToRead > pWav->bytesRemaining) {
+                bytesToRead = (size_t)pWav->bytesRemaining;
+            }
 
-                pWav->ima.predictor[0] = drwav__bytes_to_s16(header + 0);
-                pWav->ima.stepIndex[0] = header[2];
-                pWav->ima.predictor[1] = drwav__bytes_to_s16(header + 4);
-                pWav->ima.stepIndex[1] = header[6];
+            size_t bytesRead = pWav->onRead(pWav->pUserData, pWav->compressed.pBlock, bytesToRead);
+            pWav->bytesRemaining -= bytesRead;
 
-                pWav->ima.cachedSamples[drwav_countof(pWav->ima.cachedSamples) - 2] = pWav->ima.predictor[0];
-                pWav->ima.cachedSamples[drwav_countof(pWav->ima.cachedSamples) - 1] = pWav->ima.predictor[1];
-                pWav->ima.cachedSampleCount = 2;
+            drwav_int16* pBlockOut = (samplesRemaining >= samplesPerBlock) ? pBufferOut : pWav->compressed.pBlockSamples;
+            drwav_uint64 samplesDecoded = drwav_decode_block_s16(pWav, pWav->compressed.pBlock, bytesRead, pBlockOut);
+            if (samplesDecoded == 0) {
+                return totalSamplesRead;
             }
-        }
 
-        // Output anything that's cached.
-        while (samplesToRead > 0 && pWav->ima.cachedSampleCount > 0 && pWav->compressed.iCurrentSample < pWav->totalSampleCount) {
-            pBufferOut[0] = (drwav_int16)pWav->ima.cachedSamples[drwav_countof(pWav->ima.cachedSamples) - pWav->ima.cachedSampleCount];
-            pWav->ima.cachedSampleCount -= 1;
+            if (pBlockOut == pBufferOut) {
+                pBufferOut += samplesDecoded;
+                samplesToRead -= samplesDecoded;
+                totalSamplesRead += samplesDecoded;
+                pWav->compressed.iCurrentSample += samplesDecoded;
+                continue;
+            }
 
-            pBufferOut += 1;
-            samplesToRead -= 1;
-            totalSamplesRead += 1;
-            pWav->compressed.iCurrentSample += 1;
+            pWav->compressed.blockSampleCount = samplesDecoded;
+            pWav->compressed.iBlockSample = 0;
         }
 
-        if (samplesToRead == 0) {
-            return totalSamplesRead;
+        // Output what's left of the current block.
+        drwav_uint64 samplesToCopy = pWav->compressed.blockSampleCount - pWav->compressed.iBlockSample;
+        if (samplesToCopy > samplesRemaining) {
+            samplesToCopy = samplesRemaining;
         }
 
-        // If there's nothing left in the cache, just go ahead and load more. If there's nothing left to load in the current block we just continue to the next
-        // loop iteration which will trigger the loading of a new block.
-        if (pWav->ima.cachedSampleCount == 0) {
-            if (pWav->ima.bytesRemainingInBlock == 0) {
-                continue;
-            } else {
-                static drwav_int32 indexTable[16] = {
-                    -1, -1, -1, -1, 2, 4, 6, 8,
-                    -1, -1, -1, -1, 2, 4, 6, 8
-                };
-
-                static drwav_int32 stepTable[89] = {
-                    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,
-                    19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
-                    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
-                    130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
-                    337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
-                    876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
-                    2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
-                    5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487, 12635, 13899,
-                    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
-                };
-
-                // From what I can tell with stereo streams, it looks like every 4 bytes (8 samples) is for one channel. So it goes 4 bytes for the
-                // left channel, 4 bytes for the right channel.
-                pWav->ima.cachedSampleCount = 8 * pWav->channels;
-                for (drwav_uint32 iChannel = 0; iChannel < pWav->channels; ++iChannel) {
-                    drwav_uint8 nibbles[4];
-                    if (pWav->onRead(pWav->pUserData, &nibbles, 4) != 4) {
-                        return totalSamplesRead;
-                    }
-                    pWav->ima.bytesRemainingInBlock -= 4;
-
-                    for (drwav_uint32 iByte = 0; iByte < 4; ++iByte) {
-                        drwav_uint8 nibble0 = ((nibbles[iByte] & 0x0F) >> 0);
-                        drwav_uint8 nibble1 = ((nibbles[iByte] & 0xF0) >> 4);
-
-                        drwav_int32 step      = stepTable[pWav->ima.stepIndex[iChannel]];
-                        drwav_int32 predictor = pWav->ima.predictor[iChannel];
-
-                        drwav_int32      diff  = step >> 3;
-                        if (nibble0 & 1) diff += step >> 2;
-                        if (nibble0 & 2) diff += step >> 1;
-                        if (nibble0 & 4) diff += step;
-                        if (nibble0 & 8) diff  = -diff;
-
-                        predictor = drwav_clamp(predictor + diff, -32768, 32767);
-                        pWav->ima.predictor[iChannel] = predictor;
-                        pWav->ima.stepIndex[iChannel] = drwav_clamp(pWav->ima.stepIndex[iChannel] + indexTable[nibble0], 0, (drwav_int32)drwav_countof(stepTable)-1);
-                        pWav->ima.cachedSamples[(drwav_countof(pWav->ima.cachedSamples) - pWav->ima.cachedSampleCount) + (iByte*2+0)*pWav->channels + iChannel] = predictor;
-
-
-                        step      = stepTable[pWav->ima.stepIndex[iChannel]];
-                        predictor = pWav->ima.predictor[iChannel];
-
-                                         diff  = step >> 3;
-                        if (nibble1 & 1) diff += step >> 2;
-                        if (nibble1 & 2) diff += step >> 1;
-                        if (nibble1 & 4) diff += step;
-                        if (nibble1 & 8) diff  = -diff;
-
-                        predictor = drwav_clamp(predictor + diff, -32768, 32767);
-                        pWav->ima.predictor[iChannel] = predictor;
-                        pWav->ima.stepIndex[iChannel] = drwav_clamp(pWav->ima.stepIndex[iChannel] + indexTable[nibble1], 0, (drwav_int32)drwav_countof(stepTable)-1);
-                        pWav->ima.cachedSamples[(drwav_countof(pWav->ima.cachedSamples) - pWav->ima.cachedSampleCount) + (iByte*2+1)*pWav->channels + iChannel] = predictor;
-                    }
-                }
-            }
-        }
+        drwav_copy_memory(pBufferOut, pWav->compressed.pBlockSamples + pWav->compressed.iBlockSample, (size_t)samplesToCopy * sizeof(drwav_int16));
+        pWav->compressed.iBlockSample += samplesToCopy;
+
+        pBufferOut += samplesToCopy;
+        samplesToRead -= samplesToCopy;
+        totalSamplesRead += samplesToCopy;
+        pWav->compressed.iCurrentSample += samplesToCopy;
     }
 
     return totalSamplesRead;
 }
 
+drwav_uint64 drwav_read_s16__msadpcm(drwav* pWav, drwav_uint64 samplesToRead, drwav_int16* pBufferOut)
+{
+    return drwav_read_s16__compressed(pWav, samplesToRead, pBufferOut);
+}
 
-#ifndef DR_WAV_NO_CONVERSION_API
-static unsigned short g_drwavAlawTable[256] = {
-    0xEA80, 0xEB80, 0xE880, 0xE980, 0xEE80, 0xEF80, 0xEC80, 0xED80, 0xE280, 0xE380, 0xE080, 0xE180, 0xE680, 0xE780, 0xE480, 0xE580,
-    0xF540, 0xF5C0, 0xF440, 0xF4C0, 0xF740, 0xF7C0, 0xF640, 0xF6C0, 0xF140, 0xF1C0, 0xF040, 0xF0C0, 0xF340, 0xF3C0, 0xF240, 0xF2C0,
-    0xAA00, 0xAE00, 0xA200, 0xA600, 0xBA00, 0xBE00, 0xB200, 0xB600, 0x8A00, 0x8E00, 0x8200, 0x8600, 0x9A00, 0x9E00, 0x9200, 0x9600,
-    0xD500, 0xD700, 0xD100, 0xD300, 0xDD00, 0xDF00, 0xD900, 0xDB00, 0xC500, 0xC700, 0xC100, 0xC300, 0xCD00, 0xCF00, 0xC900, 0xCB00,
-    0xFEA8, 0xFEB8, 0xFE88, 0xFE98, 0xFEE8, 0xFEF8, 0xFEC8, 0xFED8, 0xFE28, 0xFE38, 0xFE08, 0xFE18, 0xFE68, 0xFE78, 0xFE48, 0xFE58,
-    0xFFA8, 0xFFB8, 0xFF88, 0xFF98, 0xFFE8, 0xFFF8, 0xFFC8, 0xFFD8, 0xFF28, 0xFF38, 0xFF08, 0xFF18, 0xFF68, 0xFF78, 0xFF48, 0xFF58,
-    0xFAA0, 0xFAE0, 0xFA20, 0xFA60, 0xFBA0, 0xFBE0, 0xFB20, 0xFB60, 0xF8A0, 0xF8E0, 0xF820, 0xF860, 0xF9A0, 0xF9E0, 0xF920, 0xF960,
-    0xFD50, 0xFD70, 0xFD10, 0xFD30, 0xFDD0, 0xFDF0, 0xFD90, 0xFDB0, 0xFC50, 0xFC70, 0xFC10, 0xFC30, 0xFCD0, 0xFCF0, 0xFC90, 0xFCB0,
-    0x1580, 0x1480, 0x1780, 0x1680, 0x1180, 0x1080, 0x1380, 0x1280, 0x1D80, 0x1C80, 0x1F80, 0x1E80, 0x1980, 0x1880, 0x1B80, 0x1A80,
-    0x0AC0, 0x0A40, 0x0BC0, 0x0B40, 0x08C0, 0x0840, 0x09C0, 0x0940, 0x0EC0, 0x0E40, 0x0FC0, 0x0F40, 0x0CC0, 0x0C40, 0x0DC0, 0x0D40,
-    0x5600, 0x5200, 0x5E00, 0x5A00, 0x4600, 0x4200, 0x4E00, 0x4A00, 0x7600, 0x7200, 0x7E00, 0x7A00, 0x6600, 0x6200, 0x6E00, 0x6A00,
-    0x2B00, 0x2900, 0x2F00, 0x2D00, 0x2300, 0x2100, 0x2700, 0x2500, 0x3B00, 0x3900, 0x3F00, 0x3D00, 0x3300, 0x3100, 0x3700, 0x3500,
-    0x0158, 0x0148, 0x0178, 0x0168, 0x0118, 0x0108, 0x0138, 0x0128, 0x01D8, 0x01C8, 0x01F8, 0x01E8, 0x0198, 0x0188, 0x01B8, 0x01A8,
-    0x0058, 0x0048, 0x0078, 0x0068, 0x0018, 0x0008, 0x0038, 0x0028, 0x00D8, 0x00C8, 0x00F8, 0x00E8, 0x0098, 0x0088, 0x00B8, 0x00A8,
-    0x0560, 0x0520, 0x05E0, 0x05A0, 0x0460, 0x0420, 0x04E0, 0x04A0, 0x0760, 0x0720, 0x07E0, 0x07A0, 0x0660, 0x0620, 0x06E0, 0x06A0,
-    0x02B0, 0x0290, 0x02F0, 0x02D0, 0x0230, 0x0210, 0x0270, 0x0250, 0x03B0, 0x0390, 0x03F0, 0x03D0, 0x0330, 0x0310, 0x0370, 0x0350
-};
+drwav_uint64 drwav_read_s16__ima(drwav* pWav, drwav_uint64 samplesToRead, drwav_int16* pBufferOut)
+{
+    return drwav_read_s16__compressed(pWav, samplesToRead, pBufferOut);
+}
 
-static unsigned short g_drwavMulawTable[256] = {
-    0x8284, 0x8684, 0x8A84, 0x8E84, 0x9284, 0x9684, 0x9A84, 0x9E84, 0xA284, 0xA684, 0xAA84, 0xAE84, 0xB284, 0xB684, 0xBA84, 0xBE84,
-    0xC184, 0xC384, 0xC584, 0xC784, 0xC984, 0xCB84, 0xCD84, 0xCF84, 0xD184, 0xD384, 0xD584, 0xD784, 0xD984, 0xDB84, 0xDD84, 0xDF84,
-    0xE104, 0xE204, 0xE304, 0xE404, 0xE504, 0xE604, 0xE704, 0xE804, 0xE904, 0xEA04, 0xEB04, 0xEC04, 0xED04, 0xEE04, 0xEF04, 0xF004,
-    0xF0C4, 0xF144, 0xF1C4, 0xF244, 0xF2C4, 0xF344, 0xF3C4, 0xF444, 0xF4C4, 0xF544, 0xF5C4, 0xF644, 0xF6C4, 0xF744, 0xF7C4, 0xF844,
-    0xF8A4, 0xF8E4, 0xF924, 0xF964, 0xF9A4, 0xF9E4, 0xFA24, 0xFA64, 0xFAA4, 0xFAE4, 0xFB24, 0xFB64, 0xFBA4, 0xFBE4, 0xFC24, 0xFC64,
-    0xFC94, 0xFCB4, 0xFCD4, 0xFCF4, 0xFD14, 0xFD34, 0xFD54, 0xFD74, 0xFD94, 0xFDB4, 0xFDD4, 0xFDF4, 0xFE14, 0xFE34, 0xFE54, 0xFE74,
-    0xFE8C, 0xFE9C, 0xFEAC, 0xFEBC, 0xFECC, 0xFEDC, 0xFEEC, 0xFEFC, 0xFF0C, 0xFF1C, 0xFF2C, 0xFF3C, 0xFF4C, 0xFF5C, 0xFF6C, 0xFF7C,
-    0xFF88, 0xFF90, 0xFF98, 0xFFA0, 0xFFA8, 0xFFB0, 0xFFB8, 0xFFC0, 0xFFC8, 0xFFD0, 0xFFD8, 0xFFE0, 0xFFE8, 0xFFF0, 0xFFF8, 0x0000,
-    0x7D7C, 0x797C, 0x757C, 0x717C, 0x6D7C, 0x697C, 0x657C, 0x617C, 0x5D7C, 0x597C, 0x557C, 0x517C, 0x4D7C, 0x497C, 0x457C, 0x417C,
-    0x3E7C, 0x3C7C, 0x3A7C, 0x387C, 0x367C, 0x347C, 0x327C, 0x307C, 0x2E7C, 0x2C7C, 0x2A7C, 0x287C, 0x267C, 0x247C, 0x227C, 0x207C,
-    0x1EFC, 0x1DFC, 0x1CFC, 0x1BFC, 0x1AFC, 0x19FC, 0x18FC, 0x17FC, 0x16FC, 0x15FC, 0x14FC, 0x13FC, 0x12FC, 0x11FC, 0x10FC, 0x0FFC,
-    0x0F3C, 0x0EBC, 0x0E3C, 0x0DBC, 0x0D3C, 0x0CBC, 0x0C3C, 0x0BBC, 0x0B3C, 0x0ABC, 0x0A3C, 0x09BC, 0x093C, 0x08BC, 0x083C, 0x07BC,
-    0x075C, 0x071C, 0x06DC, 0x069C, 0x065C, 0x061C, 0x05DC, 0x059C, 0x055C, 0x051C, 0x04DC, 0x049C, 0x045C, 0x041C, 0x03DC, 0x039C,
-    0x036C, 0x034C, 0x032C, 0x030C, 0x02EC, 0x02CC, 0x02AC, 0x028C, 0x026C, 0x024C, 0x022C, 0x020C, 0x01EC, 0x01CC, 0x01AC, 0x018C,
-    0x0174, 0x0164, 0x0154, 0x0144, 0x0134, 0x0124, 0x0114, 0x0104, 0x00F4, 0x00E4, 0x00D4, 0x00C4, 0x00B4, 0x00A4, 0x0094, 0x0084,
-    0x0078, 0x0070, 0x0068, 0x0060, 0x0058, 0x0050, 0x0048, 0x0040, 0x0038, 0x0030, 0x0028, 0x0020, 0x0018, 0x0010, 0x0008, 0x0000
-};
+
+#ifndef DR_WAV_NO_CONVERSION_API
+// The 16-bit expansion of every A-law and u-law byte.
+#define DRWAV__ALAW_TABLE(X) \
+    X(0xEA80) X(0xEB80) X(0xE880) X(0xE980) X(0xEE80) X(0xEF80) X(0xEC80) X(0xED80) X(0xE280) X(0xE380) X(0xE080) X(0xE180) X(0xE680) X(0xE780) X(0xE480) X(0xE580) \
+    X(0xF540) X(0xF5C0) X(0xF440) X(0xF4C0) X(0xF740) X(0xF7C0) X(0xF640) X(0xF6C0) X(0xF140) X(0xF1C0) X(0xF040) X(0xF0C0) X(0xF340) X(0xF3C0) X(0xF240) X(0xF2C0) \
+    X(0xAA00) X(0xAE00) X(0xA200) X(0xA600) X(0xBA00) X(0xBE00) X(0xB200) X(0xB600) X(0x8A00) X(0x8E00) X(0x8200) X(0x8600) X(0x9A00) X(0x9E00) X(0x9200) X(0x9600) \
+    X(0xD500) X(0xD700) X(0xD100) X(0xD300) X(0xDD00) X(0xDF00) X(0xD900) X(0xDB00) X(0xC500) X(0xC700) X(0xC100) X(0xC300) X(0xCD00) X(0xCF00) X(0xC900) X(0xCB00) \
+    X(0xFEA8) X(0xFEB8) X(0xFE88) X(0xFE98) X(0xFEE8) X(0xFEF8) X(0xFEC8) X(0xFED8) X(0xFE28) X(0xFE38) X(0xFE08) X(0xFE18) X(0xFE68) X(0xFE78) X(0xFE48) X(0xFE58) \
+    X(0xFFA8) X(0xFFB8) X(0xFF88) X(0xFF98) X(0xFFE8) X(0xFFF8) X(0xFFC8) X(0xFFD8) X(0xFF28) X(0xFF38) X(0xFF08) X(0xFF18) X(0xFF68) X(0xFF78) X(0xFF48) X(0xFF58) \
+    X(0xFAA0) X(0xFAE0) X(0xFA20) X(0xFA60) X(0xFBA0) X(0xFBE0) X(0xFB20) X(0xFB60) X(0xF8A0) X(0xF8E0) X(0xF820) X(0xF860) X(0xF9A0) X(0xF9E0) X(0xF920) X(0xF960) \
+    X(0xFD50) X(0xFD70) X(0xFD10) X(0xFD30) X(0xFDD0) X(0xFDF0) X(0xFD90) X(0xFDB0) X(0xFC50) X(0xFC70) X(0xFC10) X(0xFC30) X(0xFCD0) X(0xFCF0) X(0xFC90) X(0xFCB0) \
+    X(0x1580) X(0x1480) X(0x1780) X(0x1680) X(0x1180) X(0x1080) X(0x1380) X(0x1280) X(0x1D80) X(0x1C80) X(0x1F80) X(0x1E80) X(0x1980) X(0x1880) X(0x1B80) X(0x1A80) \
+    X(0x0AC0) X(0x0A40) X(0x0BC0) X(0x0B40) X(0x08C0) X(0x0840) X(0x09C0) X(0x0940) X(0x0EC0) X(0x0E40) X(0x0FC0) X(0x0F40) X(0x0CC0) X(0x0C40) X(0x0DC0) X(0x0D40) \
+    X(0x5600) X(0x5200) X(0x5E00) X(0x5A00) X(0x4600) X(0x4200) X(0x4E00) X(0x4A00) X(0x7600) X(0x7200) X(0x7E00) X(0x7A00) X(0x6600) X(0x6200) X(0x6E00) X(0x6A00) \
+    X(0x2B00) X(0x2900) X(0x2F00) X(0x2D00) X(0x2300) X(0x2100) X(0x2700) X(0x2500) X(0x3B00) X(0x3900) X(0x3F00) X(0x3D00) X(0x3300) X(0x3100) X(0x3700) X(0x3500) \
+    X(0x0158) X(0x0148) X(0x0178) X(0x0168) X(0x0118) X(0x0108) X(0x0138) X(0x0128) X(0x01D8) X(0x01C8) X(0x01F8) X(0x01E8) X(0x0198) X(0x0188) X(0x01B8) X(0x01A8) \
+    X(0x0058) X(0x0048) X(0x0078) X(0x0068) X(0x0018) X(0x0008) X(0x0038) X(0x0028) X(0x00D8) X(0x00C8) X(0x00F8) X(0x00E8) X(0x0098) X(0x0088) X(0x00B8) X(0x00A8) \
+    X(0x0560) X(0x0520) X(0x05E0) X(0x05A0) X(0x0460) X(0x0420) X(0x04E0) X(0x04A0) X(0x0760) X(0x0720) X(0x07E0) X(0x07A0) X(0x0660) X(0x0620) X(0x06E0) X(0x06A0) \
+    X(0x02B0) X(0x0290) X(0x02F0) X(0x02D0) X(0x0230) X(0x0210) X(0x0270) X(0x0250) X(0x03B0) X(0x0390) X(0x03F0) X(0x03D0) X(0x0330) X(0x0310) X(0x0370) X(0x0350)
+
+#define DRWAV__MULAW_TABLE(X) \
+    X(0x8284) X(0x8684) X(0x8A84) X(0x8E84) X(0x9284) X(0x9684) X(0x9A84) X(0x9E84) X(0xA284) X(0xA684) X(0xAA84) X(0xAE84) X(0xB284) X(0xB684) X(0xBA84) X(0xBE84) \
+    X(0xC184) X(0xC384) X(0xC584) X(0xC784) X(0xC984) X(0xCB84) X(0xCD84) X(0xCF84) X(0xD184) X(0xD384) X(0xD584) X(0xD784) X(0xD984) X(0xDB84) X(0xDD84) X(0xDF84) \
+    X(0xE104) X(0xE204) X(0xE304) X(0xE404) X(0xE504) X(0xE604) X(0xE704) X(0xE804) X(0xE904) X(0xEA04) X(0xEB04) X(0xEC04) X(0xED04) X(0xEE04) X(0xEF04) X(0xF004) \
+    X(0xF0C4) X(0xF144) X(0xF1C4) X(0xF244) X(0xF2C4) X(0xF344) X(0xF3C4) X(0xF444) X(0xF4C4) X(0xF544) X(0xF5C4) X(0xF644) X(0xF6C4) X(0xF744) X(0xF7C4) X(0xF844) \
+    X(0xF8A4) X(0xF8E4) X(0xF924) X(0xF964) X(0xF9A4) X(0xF9E4) X(0xFA24) X(0xFA64) X(0xFAA4) X(0xFAE4) X(0xFB24) X(0xFB64) X(0xFBA4) X(0xFBE4) X(0xFC24) X(0xFC64) \
+    X(0xFC94) X(0xFCB4) X(0xFCD4) X(0xFCF4) X(0xFD14) X(0xFD34) X(0xFD54) X(0xFD74) X(0xFD94) X(0xFDB4) X(0xFDD4) X(0xFDF4) X(0xFE14) X(0xFE34) X(0xFE54) X(0xFE74) \
+    X(0xFE8C) X(0xFE9C) X(0xFEAC) X(0xFEBC) X(0xFECC) X(0xFEDC) X(0xFEEC) X(0xFEFC) X(0xFF0C) X(0xFF1C) X(0xFF2C) X(0xFF3C) X(0xFF4C) X(0xFF5C) X(0xFF6C) X(0xFF7C) \
+    X(0xFF88) X(0xFF90) X(0xFF98) X(0xFFA0) X(0xFFA8) X(0xFFB0) X(0xFFB8) X(0xFFC0) X(0xFFC8) X(0xFFD0) X(0xFFD8) X(0xFFE0) X(0xFFE8) X(0xFFF0) X(0xFFF8) X(0x0000) \
+    X(0x7D7C) X(0x797C) X(0x757C) X(0x717C) X(0x6D7C) X(0x697C) X(0x657C) X(0x617C) X(0x5D7C) X(0x597C) X(0x557C) X(0x517C) X(0x4D7C) X(0x497C) X(0x457C) X(0x417C) \
+    X(0x3E7C) X(0x3C7C) X(0x3A7C) X(0x387C) X(0x367C) X(0x347C) X(0x327C) X(0x307C) X(0x2E7C) X(0x2C7C) X(0x2A7C) X(0x287C) X(0x267C) X(0x247C) X(0x227C) X(0x207C) \
+    X(0x1EFC) X(0x1DFC) X(0x1CFC) X(0x1BFC) X(0x1AFC) X(0x19FC) X(0x18FC) X(0x17FC) X(0x16FC) X(0x15FC) X(0x14FC) X(0x13FC) X(0x12FC) X(0x11FC) X(0x10FC) X(0x0FFC) \
+    X(0x0F3C) X(0x0EBC) X(0x0E3C) X(0x0DBC) X(0x0D3C) X(0x0CBC) X(0x0C3C) X(0x0BBC) X(0x0B3C) X(0x0ABC) X(0x0A3C) X(0x09BC) X(0x093C) X(0x08BC) X(0x083C) X(0x07BC) \
+    X(0x075C) X(0x071C) X(0x06DC) X(0x069C) X(0x065C) X(0x061C) X(0x05DC) X(0x059C) X(0x055C) X(0x051C) X(0x04DC) X(0x049C) X(0x045C) X(0x041C) X(0x03DC) X(0x039C) \
+    X(0x036C) X(0x034C) X(0x032C) X(0x030C) X(0x02EC) X(0x02CC) X(0x02AC) X(0x028C) X(0x026C) X(0x024C) X(0x022C) X(0x020C) X(0x01EC) X(0x01CC) X(0x01AC) X(0x018C) \
+    X(0x0174) X(0x0164) X(0x0154) X(0x0144) X(0x0134) X(0x0124) X(0x0114) X(0x0104) X(0x00F4) X(0x00E4) X(0x00D4) X(0x00C4) X(0x00B4) X(0x00A4) X(0x0094) X(0x0084) \
+    X(0x0078) X(0x0070) X(0x0068) X(0x0060) X(0x0058) X(0x0050) X(0x0048) X(0x0040) X(0x0038) X(0x0030) X(0x0028) X(0x0020) X(0x0018) X(0x0010) X(0x0008) X(0x0000)
+
+// The tables for each output type are expanded from the lists above at compile time. They hold exactly what the scalar
+// conversions of the 16-bit values would produce.
+#define DRWAV__TABLE_S16(value) (value),
+#define DRWAV__TABLE_F32(value) ((drwav_int16)(value) / 32768.0f),
+#define DRWAV__TABLE_S32(value) ((drwav_int32)(drwav_int16)(value) * 65536),
+
+static const unsigned short g_drwavAlawTable[256]     = { DRWAV__ALAW_TABLE(DRWAV__TABLE_S16) };
+static const unsigned short g_drwavMulawTable[256]    = { DRWAV__MULAW_TABLE(DRWAV__TABLE_S16) };
+static const float          g_drwavAlawTableF32[256]  = { DRWAV__ALAW_TABLE(DRWAV__TABLE_F32) };
+static const float          g_drwavMulawTableF32[256] = { DRWAV__MULAW_TABLE(DRWAV__TABLE_F32) };
+static const drwav_int32    g_drwavAlawTableS32[256]  = { DRWAV__ALAW_TABLE(DRWAV__TABLE_S32) };
+static const drwav_int32    g_drwavMulawTableS32[256] = { DRWAV__MULAW_TABLE(DRWAV__TABLE_S32) };
 
 static DRWAV_INLINE drwav_int16 drwav__alaw_to_s16(drwav_uint8 sampleIn)
 {
@@ -2425,6 +2527,76 @@ static DRWAV_INLINE drwav_int16 drwav__mulaw_to_s16(drwav_uint8 sampleIn)
 
 
 
+// Converts raw samples of the file's format. pOut and pIn never overlap.
+typedef void (* drwav__convert_proc)(void* pOut, const unsigned char* pIn, size_t sampleCount, unsigned short bytesPerSample);
+
+// Reads samples and converts them with onConvert.
+//
+// Large reads go straight into the output buffer with a single drwav_read() per span, and are converted front to back.
+// Raw samples narrower than the output go at the end of the output buffer, so the output grows towards raw data it has
+// not converted yet. Wider raw samples go at the start, as many as fit. A chunk whose output would overlap its own raw
+// data is copied to a small buffer on the stack first. Small reads go through that buffer directly.
+static drwav_uint64 drwav__read_and_convert(drwav* pWav, drwav_uint64 samplesToRead, void* pBufferOut, size_t bytesPerOutputSample, drwav__convert_proc onConvert)
+{
+    size_t bytesPerSample = pWav->bytesPerSample;
+    if (bytesPerSample == 0) {
+        return 0;
+    }
+
+    drwav_uint64 totalSamplesRead = 0;
+    unsigned char* pOut = (unsigned char*)pBufferOut;
+    unsigned char sampleData[4096];
+    while (samplesToRead > 0) {
+        size_t spanSize;
+        size_t rawOffset = 0;
+        if (bytesPerSample < bytesPerOutputSample) {
+            spanSize  = (size_t)drwav_min(samplesToRead, SIZE_MAX / bytesPerOutputSample);
+            rawOffset = spanSize * (bytesPerOutputSample - bytesPerSample);
+        } else {
+            spanSize  = (size_t)drwav_min(samplesToRead, SIZE_MAX / bytesPerSample) * bytesPerOutputSample / bytesPerSample;
+        }
+
+        unsigned char* pRaw = pOut + rawOffset;
+        if (spanSize < sizeof(sampleData)/bytesPerSample) {
+            spanSize = (size_t)drwav_min(samplesToRead, sizeof(sampleData)/bytesPerSample);
+            pRaw = sampleData;
+        }
+
+        size_t samplesRead = (size_t)drwav_read(pWav, spanSize, pRaw);
+        if (samplesRead == 0) {
+            break;
+        }
+
+        if (pRaw == sampleData) {
+            onConvert(pOut, sampleData, samplesRead, pWav->bytesPerSample);
+        } else {
+            // The raw data of sample i never starts before its output, and only samples up to i are written.
+            size_t i = 0;
+            while (i < samplesRead) {
+                const unsigned char* pChunkIn = pRaw + i*bytesPerSample;
+                unsigned char* pChunkOut = pOut + i*bytesPerOutputSample;
+                size_t count = (size_t)(pChunkIn - pChunkOut) / bytesPerOutputSample;
+                if (count >= 256) {
+                    count = drwav_min(count, samplesRead - i);
+                } else {
+                    count = drwav_min(samplesRead - i, sizeof(sampleData)/bytesPerSample);
+                    drwav_copy_memory(sampleData, pChunkIn, count*bytesPerSample);
+                    pChunkIn = sampleData;
+                }
+
+                onConvert(pChunkOut, pChunkIn, count, pWav->bytesPerSample);
+                i += count;
+            }
+        }
+
+        pOut             += samplesRead * bytesPerOutputSample;
+        samplesToRead    -= samplesRead;
+        totalSamplesRead += samplesRead;
+    }
+
+    return totalSamplesRead;
+}
+
 static void drwav__pcm_to_s16(drwav_int16* pOut, const unsigned char* pIn, size_t totalSampleCount, unsigned short bytesPerSample)
 {
     // Special case for 8-bit sample data because it's treated as unsigned.
@@ -2489,6 +2661,11 @@ static void drwav__ieee_to_s16(drwav_int16* pOut, const unsigned char* pIn, size
     }
 }
 
+static void drwav__convert_pcm_to_s16(void* pOut, const unsigned char* pIn, size_t sampleCount, unsigned short bytesPerSample)
+{
+    drwav__pcm_to_s16((drwav_int16*)pOut, pIn, sampleCount, bytesPerSample);
+}
+
 drwav_uint64 drwav_read_s16__pcm(drwav* pWav, drwav_uint64 samplesToRead, drwav_int16* pBufferOut)
 {
     // Fast path.
@@ -2496,82 +2673,39 @@ drwav_uint64 drwav_read_s16__pcm(drwav* pWav, drwav_uint64 samplesToRead, drwav_
         return drwav_read(pWav, samplesToRead, pBufferOut);
     }
 
-    drwav_uint64 totalSamplesRead = 0;
-    unsigned char sampleData[4096];
-    while (samplesToRead > 0) {
-        drwav_uint64 samplesRead = drwav_read(pWav, drwav_min(samplesToRead, sizeof(sampleData)/pWav->bytesPerSample), sampleData);
-        if (samplesRead == 0) {
-            break;
-        }
-
-        drwav__pcm_to_s16(pBufferOut, sampleData, (size_t)samplesRead, pWav->bytesPerSample);
-
-        pBufferOut       += samplesRead;
-        samplesToRead    -= samplesRead;
-        totalSamplesRead += samplesRead;
-    }
+    return drwav__read_and_convert(pWav, samplesToRead, pBufferOut, sizeof(*pBufferOut), drwav__convert_pcm_to_s16);
+}
 
-    return totalSamplesRead;
+static void drwav__convert_ieee_to_s16(void* pOut, const unsigned char* pIn, size_t sampleCount, unsigned short bytesPerSample)
+{
+    drwav__ieee_to_s16((drwav_int16*)pOut, pIn, sampleCount, bytesPerSample);
 }
 
 drwav_uint64 drwav_read_s16__ieee(drwav* pWav, drwav_uint64 samplesToRead, drwav_int16* pBufferOut)
 {
-    drwav_uint64 totalSamplesRead = 0;
-    unsigned char sampleData[4096];
-    while (samplesToRead > 0) {
-        drwav_uint64 samplesRead = drwav_read(pWav, drwav_min(samplesToRead, sizeof(sampleData)/pWav->bytesPerSample), sampleData);
-        if (samplesRead == 0) {
-            break;
-        }
+    return drwav__read_and_convert(pWav, samplesToRead, pBufferOut, sizeof(*pBufferOut), drwav__convert_ieee_to_s16);
+}
 
-        drwav__ieee_to_s16(pBufferOut, sampleData, (size_t)samplesRead, pWav->bytesPerSample);
-
-        pBufferOut       += samplesRead;
-        samplesToRead    -= samplesRead;
-        totalSamplesRead += samplesRead;
-    }
-
-    return totalSamplesRead;
-}
+static void drwav__convert_alaw_to_s16(void* pOut, const unsigned char* pIn, size_t sampleCount, unsigned short bytesPerSample)
+{
+    (void)bytesPerSample;
+    drwav_alaw_to_s16((drwav_int16*)pOut, pIn, sampleCount);
+}
 
 drwav_uint64 drwav_read_s16__alaw(drwav* pWav, drwav_uint64 samplesToRead, drwav_int16* pBufferOut)
 {
-    drwav_uint64 totalSamplesRead = 0;
-    unsigned char sampleData[4096];
-    while (samplesToRead > 0) {
-        drwav_uint64 samplesRead = drwav_read(pWav, drwav_min(samplesToRead, sizeof(sampleData)/pWav->bytesPerSample), sampleData);
-        if (samplesRead == 0) {
-            break;
-        }
-
-        drwav_alaw_to_s16(pBufferOut, sampleData, (size_t)samplesRead);
-
-        pBufferOut       += samplesRead;
-        samplesToRead    -= samplesRead;
-        totalSamplesRead += samplesRead;
-    }
+    return drwav__read_and_convert(pWav, samplesToRead, pBufferOut, sizeof(*pBufferOut), drwav__convert_alaw_to_s16);
+}
 
-    return totalSamplesRead;
+static void drwav__convert_mulaw_to_s16(void* pOut, const unsigned char* pIn, size_t sampleCount, unsigned short bytesPerSample)
+{
+    (void)bytesPerSample;
+    drwav_mulaw_to_s16((drwav_int16*)pOut, pIn, sampleCount);
 }
 
 drwav_uint64 drwav_read_s16__mulaw(drwav* pWav, drwav_uint64 samplesToRead, drwav_int16* pBufferOut)
 {
-    drwav_uint64 totalSamplesRead = 0;
-    unsigned char sampleData[4096];
-    while (samplesToRead > 0) {
-        drwav_uint64 samplesRead = drwav_read(pWav, drwav_min(samplesToRead, sizeof(sampleData)/pWav->bytesPerSample), sampleData);
-        if (samplesRead == 0) {
-            break;
-        }
-
-        drwav_mulaw_to_s16(pBufferOut, sampleData, (size_t)samplesRead);
-
-        pBufferOut       += samplesRead;
-        samplesToRead    -= samplesRead;
-        totalSamplesRead += samplesRead;
-    }
-
-    return totalSamplesRead;
+    return drwav__read_and_convert(pWav, samplesToRead, pBufferOut, sizeof(*pBufferOut), drwav__convert_mulaw_to_s16);
 }
 
 drwav_uint64 drwav_read_s16(drwav* pWav, drwav_uint64 samplesToRead, drwav_int16* pBufferOut)
@@ -2751,28 +2885,18 @@ static void drwav__ieee_to_f32(float* pOut, const unsigned char* pIn, size_t sam
 }
 
 
+static void drwav__convert_pcm_to_f32(void* pOut, const unsigned char* pIn, size_t sampleCount, unsigned short bytesPerSample)
+{
+    drwav__pcm_to_f32((float*)pOut, pIn, sampleCount, bytesPerSample);
+}
+
 drwav_uint64 drwav_read_f32__pcm(drwav* pWav, drwav_uint64 samplesToRead, float* pBufferOut)
 {
     if (pWav->bytesPerSample == 0) {
         return 0;
     }
 
-    drwav_uint64 totalSamplesRead = 0;
-    unsigned char sampleData[4096];
-    while (samplesToRead > 0) {
-        drwav_uint64 samplesRead = drwav_read(pWav, drwav_min(samplesToRead, sizeof(sampleData)/pWav->bytesPerSample), sampleData);
-        if (samplesRead == 0) {
-            break;
-        }
-
-        drwav__pcm_to_f32(pBufferOut, sampleData, (size_t)samplesRead, pWav->bytesPerSample);
-        pBufferOut += samplesRead;
-
-        samplesToRead    -= samplesRead;
-        totalSamplesRead += samplesRead;
-    }
-
-    return totalSamplesRead;
+    return drwav__read_and_convert(pWav, samplesToRead, pBufferOut, sizeof(*pBufferOut), drwav__convert_pcm_to_f32);
 }
 
 drwav_uint64 drwav_read_f32__msadpcm(drwav* pWav, drwav_uint64 samplesToRead, float* pBufferOut)
@@ -2819,6 +2943,11 @@ drwav_uint64 drwav_read_f32__ima(drwav* pWav, drwav_uint64 samplesToRead, float*
     return totalSamplesRead;
 }
 
+static void drwav__convert_ieee_to_f32(void* pOut, const unsigned char* pIn, size_t sampleCount, unsigned short bytesPerSample)
+{
+    drwav__ieee_to_f32((float*)pOut, pIn, sampleCount, bytesPerSample);
+}
+
 drwav_uint64 drwav_read_f32__ieee(drwav* pWav, drwav_uint64 samplesToRead, float* pBufferOut)
 {
     // Fast path.
@@ -2830,22 +2959,13 @@ drwav_uint64 drwav_read_f32__ieee(drwav* pWav, drwav_uint64 samplesToRead, float
         return 0;
     }
 
-    drwav_uint64 totalSamplesRead = 0;
-    unsigned char sampleData[4096];
-    while (samplesToRead > 0) {
-        drwav_uint64 samplesRead = drwav_read(pWav, drwav_min(samplesToRead, sizeof(sampleData)/pWav->bytesPerSample), sampleData);
-        if (samplesRead == 0) {
-            break;
-        }
-
-        drwav__ieee_to_f32(pBufferOut, sampleData, (size_t)samplesRead, pWav->bytesPerSample);
-
-        pBufferOut       += samplesRead;
-        samplesToRead    -= samplesRead;
-        totalSamplesRead += samplesRead;
-    }
+    return drwav__read_and_convert(pWav, samplesToRead, pBufferOut, sizeof(*pBufferOut), drwav__convert_ieee_to_f32);
+}
 
-    return totalSamplesRead;
+static void drwav__convert_alaw_to_f32(void* pOut, const unsigned char* pIn, size_t sampleCount, unsigned short bytesPerSample)
+{
+    (void)bytesPerSample;
+    drwav_alaw_to_f32((float*)pOut, pIn, sampleCount);
 }
 
 drwav_uint64 drwav_read_f32__alaw(drwav* pWav, drwav_uint64 samplesToRead, float* pBufferOut)
@@ -2854,22 +2974,13 @@ drwav_uint64 drwav_read_f32__alaw(drwav* pWav, drwav_uint64 samplesToRead, float
         return 0;
     }
 
-    drwav_uint64 totalSamplesRead = 0;
-    unsigned char sampleData[4096];
-    while (samplesToRead > 0) {
-        drwav_uint64 samplesRead = drwav_read(pWav, drwav_min(samplesToRead, sizeof(sampleData)/pWav->bytesPerSample), sampleData);
-        if (samplesRead == 0) {
-            break;
-        }
-
-        drwav_alaw_to_f32(pBufferOut, sampleData, (size_t)samplesRead);
-
-        pBufferOut       += samplesRead;
-        samplesToRead    -= samplesRead;
-        totalSamplesRead += samplesRead;
-    }
+    return drwav__read_and_convert(pWav, samplesToRead, pBufferOut, sizeof(*pBufferOut), drwav__convert_alaw_to_f32);
+}
 
-    return totalSamplesRead;
+static void drwav__convert_mulaw_to_f32(void* pOut, const unsigned char* pIn, size_t sampleCount, unsigned short bytesPerSample)
+{
+    (void)bytesPerSample;
+    drwav_mulaw_to_f32((float*)pOut, pIn, sampleCount);
 }
 
 drwav_uint64 drwav_read_f32__mulaw(drwav* pWav, drwav_uint64 samplesToRead, float* pBufferOut)
@@ -2878,22 +2989,7 @@ drwav_uint64 drwav_read_f32__mulaw(drwav* pWav, drwav_uint64 samplesToRead, floa
         return 0;
     }
 
-    drwav_uint64 totalSamplesRead = 0;
-    unsigned char sampleData[4096];
-    while (samplesToRead > 0) {
-        drwav_uint64 samplesRead = drwav_read(pWav, drwav_min(samplesToRead, sizeof(sampleData)/pWav->bytesPerSample), sampleData);
-        if (samplesRead == 0) {
-            break;
-        }
-
-        drwav_mulaw_to_f32(pBufferOut, sampleData, (size_t)samplesRead);
-
-        pBufferOut       += samplesRead;
-        samplesToRead    -= samplesRead;
-        totalSamplesRead += samplesRead;
-    }
-
-    return totalSamplesRead;
+    return drwav__read_and_convert(pWav, samplesToRead, pBufferOut, sizeof(*pBufferOut), drwav__convert_mulaw_to_f32);
 }
 
 drwav_uint64 drwav_read_f32(drwav* pWav, drwav_uint64 samplesToRead, float* pBufferOut)
@@ -2934,6 +3030,196 @@ drwav_uint64 drwav_read_f32(drwav* pWav, drwav_uint64 samplesToRead, float* pBuf
     return 0;
 }
 
+#ifdef DRWAV_SUPPORT_AVX2
+static drwav_bool32 drwav__cpuid_has_avx2()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return DRWAV_FALSE;
+    }
+
+    // The OS has to save the YMM registers too, not just the CPU support them.
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6) {
+        return DRWAV_FALSE;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+static drwav_bool32 drwav__has_avx2()
+{
+    // Every thread computes the same value, so racing on the first call is harmless.
+    static volatile int hasAVX2 = -1;
+    if (hasAVX2 < 0) {
+        hasAVX2 = drwav__cpuid_has_avx2() ? 1 : 0;
+    }
+    return hasAVX2 == 1;
+}
+#endif
+
+// The SIMD kernels convert as many samples as fit their vector width and return how many they converted. The caller
+// does the rest with the scalar code. They use the same operations as the scalar code, or operations that are exact
+// (integer to float conversions of values with at most 24 significant bits, scaling by powers of two), so the output
+// is identical.
+#ifdef DRWAV_SUPPORT_SSE2
+static size_t drwav__u8_to_f32__sse2(float* pOut, const drwav_uint8* pIn, size_t sampleCount)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 divisor = _mm_set1_ps(255.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    size_t i = 0;
+    for (; i + 16 <= sampleCount; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(pIn + i));
+        __m128i words[2] = {_mm_unpacklo_epi8(bytes, zero), _mm_unpackhi_epi8(bytes, zero)};
+        for (int j = 0; j < 2; ++j) {
+            __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(words[j], zero));
+            __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(words[j], zero));
+            _mm_storeu_ps(pOut + i + j*8 + 0, _mm_sub_ps(_mm_mul_ps(_mm_div_ps(lo, divisor), two), one));
+            _mm_storeu_ps(pOut + i + j*8 + 4, _mm_sub_ps(_mm_mul_ps(_mm_div_ps(hi, divisor), two), one));
+        }
+    }
+    return i;
+}
+
+static size_t drwav__s16_to_f32__sse2(float* pOut, const drwav_int16* pIn, size_t sampleCount)
+{
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= sampleCount; i += 8) {
+        __m128i words = _mm_loadu_si128((const __m128i*)(pIn + i));
+
+        // Sign extend by moving each sample to the top of a 32-bit lane and shifting it back down.
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(words, words), 16);
+        _mm_storeu_ps(pOut + i + 0, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(pOut + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    return i;
+}
+
+static size_t drwav__s32_to_f32__sse2(float* pOut, const drwav_int32* pIn, size_t sampleCount)
+{
+    // Rounding to float and then scaling by a power of two gives the same result as scaling and rounding in double.
+    const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= sampleCount; i += 4) {
+        __m128i samples = _mm_loadu_si128((const __m128i*)(pIn + i));
+        _mm_storeu_ps(pOut + i, _mm_mul_ps(_mm_cvtepi32_ps(samples), scale));
+    }
+    return i;
+}
+
+static size_t drwav__f64_to_f32__sse2(float* pOut, const double* pIn, size_t sampleCount)
+{
+    size_t i = 0;
+    for (; i + 4 <= sampleCount; i += 4) {
+        __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(pIn + i + 0));
+        __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(pIn + i + 2));
+        _mm_storeu_ps(pOut + i, _mm_movelh_ps(lo, hi));
+    }
+    return i;
+}
+#endif
+
+#ifdef DRWAV_SUPPORT_AVX2
+// Looks up each byte in a 256-entry table of 32-bit values, floats or integers, with a gather.
+DRWAV_TARGET_AVX2 static size_t drwav__lookup_32__avx2(void* pOut, const drwav_uint8* pIn, size_t sampleCount, const void* pTable)
+{
+    size_t i = 0;
+    for (; i + 16 <= sampleCount; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(pIn + i));
+        __m256i lo = _mm256_i32gather_epi32((const int*)pTable, _mm256_cvtepu8_epi32(bytes), 4);
+        __m256i hi = _mm256_i32gather_epi32((const int*)pTable, _mm256_cvtepu8_epi32(_mm_unpackhi_epi64(bytes, bytes)), 4);
+        _mm256_storeu_si256((__m256i*)((drwav_int32*)pOut + i + 0), lo);
+        _mm256_storeu_si256((__m256i*)((drwav_int32*)pOut + i + 8), hi);
+    }
+    return i;
+}
+
+DRWAV_TARGET_AVX2 static size_t drwav__u8_to_f32__avx2(float* pOut, const drwav_uint8* pIn, size_t sampleCount)
+{
+    const __m256 divisor = _mm256_set1_ps(255.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= sampleCount; i += 8) {
+        __m256 samples = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(pIn + i))));
+        _mm256_storeu_ps(pOut + i, _mm256_sub_ps(_mm256_mul_ps(_mm256_div_ps(samples, divisor), two), one));
+    }
+    return i;
+}
+
+DRWAV_TARGET_AVX2 static size_t drwav__s16_to_f32__avx2(float* pOut, const drwav_int16* pIn, size_t sampleCount)
+{
+    const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+
+    size_t i = 0;
+    for (; i + 16 <= sampleCount; i += 16) {
+        __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(pIn + i + 0)));
+        __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(pIn + i + 8)));
+        _mm256_storeu_ps(pOut + i + 0, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), scale));
+        _mm256_storeu_ps(pOut + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), scale));
+    }
+    return i;
+}
+
+DRWAV_TARGET_AVX2 static size_t drwav__s24_to_f32__avx2(float* pOut, const drwav_uint8* pIn, size_t sampleCount)
+{
+    // Each 128-bit lane holds four packed samples in its first 12 bytes. The shuffle moves every 3-byte sample to the
+    // top of a 32-bit lane and zeroes the low byte, which is the same as the scalar code's shifts.
+    const __m256i shuffle = _mm256_setr_epi8(
+        -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+        -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    const __m256 scale = _mm256_set1_ps(1.0f / 2147483648.0f);
+
+    // The second lane's load reads 4 bytes past the 8 samples, so stop early enough to stay inside the input.
+    size_t i = 0;
+    for (; (i + 8)*3 + 4 <= sampleCount*3; i += 8) {
+        const drwav_uint8* pBytes = pIn + i*3;
+        __m256i bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(pBytes + 0))), _mm_loadu_si128((const __m128i*)(pBytes + 12)), 1);
+        __m256i samples = _mm256_shuffle_epi8(bytes, shuffle);
+        _mm256_storeu_ps(pOut + i, _mm256_mul_ps(_mm256_cvtepi32_ps(samples), scale));
+    }
+    return i;
+}
+
+DRWAV_TARGET_AVX2 static size_t drwav__s32_to_f32__avx2(float* pOut, const drwav_int32* pIn, size_t sampleCount)
+{
+    const __m256 scale = _mm256_set1_ps(1.0f / 2147483648.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= sampleCount; i += 8) {
+        __m256i samples = _mm256_loadu_si256((const __m256i*)(pIn + i));
+        _mm256_storeu_ps(pOut + i, _mm256_mul_ps(_mm256_cvtepi32_ps(samples), scale));
+    }
+    return i;
+}
+
+DRWAV_TARGET_AVX2 static size_t drwav__f64_to_f32__avx2(float* pOut, const double* pIn, size_t sampleCount)
+{
+    size_t i = 0;
+    for (; i + 8 <= sampleCount; i += 8) {
+        __m128 lo = _mm256_cvtpd_ps(_mm256_loadu_pd(pIn + i + 0));
+        __m128 hi = _mm256_cvtpd_ps(_mm256_loadu_pd(pIn + i + 4));
+        _mm256_storeu_ps(pOut + i, _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1));
+    }
+    return i;
+}
+#endif
+
 void drwav_u8_to_f32(float* pOut, const drwav_uint8* pIn, size_t sampleCount)
 {
     if (pOut == NULL || pIn == NULL) {
@@ -2949,8 +3235,18 @@ void drwav_u8_to_f32(float* pOut, const drwav_uint8* pIn, size_t sampleCount)
         *pOut++ = (pIn[i] / 256.0f) * 2 - 1;
     }
 #else
-    for (size_t i = 0; i < sampleCount; ++i) {
-        *pOut++ = (pIn[i] / 255.0f) * 2 - 1;
+    size_t i = 0;
+#ifdef DRWAV_SUPPORT_AVX2
+    if (drwav__has_avx2()) {
+        i = drwav__u8_to_f32__avx2(pOut, pIn, sampleCount);
+    }
+#endif
+#ifdef DRWAV_SUPPORT_SSE2
+    i += drwav__u8_to_f32__sse2(pOut + i, pIn + i, sampleCount - i);
+#endif
+
+    for (; i < sampleCount; ++i) {
+        pOut[i] = (pIn[i] / 255.0f) * 2 - 1;
     }
 #endif
 }
@@ -2961,8 +3257,18 @@ void drwav_s16_to_f32(float* pOut, const drwav_int16* pIn, size_t sampleCount)
         return;
     }
 
-    for (size_t i = 0; i < sampleCount; ++i) {
-        *pOut++ = pIn[i] / 32768.0f;
+    size_t i = 0;
+#ifdef DRWAV_SUPPORT_AVX2
+    if (drwav__has_avx2()) {
+        i = drwav__s16_to_f32__avx2(pOut, pIn, sampleCount);
+    }
+#endif
+#ifdef DRWAV_SUPPORT_SSE2
+    i += drwav__s16_to_f32__sse2(pOut + i, pIn + i, sampleCount - i);
+#endif
+
+    for (; i < sampleCount; ++i) {
+        pOut[i] = pIn[i] / 32768.0f;
     }
 }
 
@@ -2972,13 +3278,21 @@ void drwav_s24_to_f32(float* pOut, const drwav_uint8* pIn, size_t sampleCount)
         return;
     }
 
-    for (size_t i = 0; i < sampleCount; ++i) {
+    // There is no SSE2 kernel, unpacking 3-byte samples needs a byte shuffle.
+    size_t i = 0;
+#ifdef DRWAV_SUPPORT_AVX2
+    if (drwav__has_avx2()) {
+        i = drwav__s24_to_f32__avx2(pOut, pIn, sampleCount);
+    }
+#endif
+
+    for (; i < sampleCount; ++i) {
         unsigned int s0 = pIn[i*3 + 0];
         unsigned int s1 = pIn[i*3 + 1];
         unsigned int s2 = pIn[i*3 + 2];
 
         int sample32 = (int)((s0 << 8) | (s1 << 16) | (s2 << 24));
-        *pOut++ = (float)(sample32 / 2147483648.0);
+        pOut[i] = (float)(sample32 / 2147483648.0);
     }
 }
 
@@ -2988,8 +3302,18 @@ void drwav_s32_to_f32(float* pOut, const drwav_int32* pIn, size_t sampleCount)
         return;
     }
 
-    for (size_t i = 0; i < sampleCount; ++i) {
-        *pOut++ = (float)(pIn[i] / 2147483648.0);
+    size_t i = 0;
+#ifdef DRWAV_SUPPORT_AVX2
+    if (drwav__has_avx2()) {
+        i = drwav__s32_to_f32__avx2(pOut, pIn, sampleCount);
+    }
+#endif
+#ifdef DRWAV_SUPPORT_SSE2
+    i += drwav__s32_to_f32__sse2(pOut + i, pIn + i, sampleCount - i);
+#endif
+
+    for (; i < sampleCount; ++i) {
+        pOut[i] = (float)(pIn[i] / 2147483648.0);
     }
 }
 
@@ -2999,8 +3323,18 @@ void drwav_f64_to_f32(float* pOut, const double* pIn, size_t sampleCount)
         return;
     }
 
-    for (size_t i = 0; i < sampleCount; ++i) {
-        *pOut++ = (float)pIn[i];
+    size_t i = 0;
+#ifdef DRWAV_SUPPORT_AVX2
+    if (drwav__has_avx2()) {
+        i = drwav__f64_to_f32__avx2(pOut, pIn, sampleCount);
+    }
+#endif
+#ifdef DRWAV_SUPPORT_SSE2
+    i += drwav__f64_to_f32__sse2(pOut + i, pIn + i, sampleCount - i);
+#endif
+
+    for (; i < sampleCount; ++i) {
+        pOut[i] = (float)pIn[i];
     }
 }
 
@@ -3010,8 +3344,15 @@ void drwav_alaw_to_f32(float* pOut, const drwav_uint8* pIn, size_t sampleCount)
         return;
     }
 
-    for (size_t i = 0; i < sampleCount; ++i) {
-        *pOut++ = drwav__alaw_to_s16(pIn[i]) / 32768.0f;
+    size_t i = 0;
+#ifdef DRWAV_SUPPORT_AVX2
+    if (drwav__has_avx2()) {
+        i = drwav__lookup_32__avx2(pOut, pIn, sampleCount, g_drwavAlawTableF32);
+    }
+#endif
+
+    for (; i < sampleCount; ++i) {
+        pOut[i] = g_drwavAlawTableF32[pIn[i]];
     }
 }
 
@@ -3021,11 +3362,183 @@ void drwav_mulaw_to_f32(float* pOut, const drwav_uint8* pIn, size_t sampleCount)
         return;
     }
 
-    for (size_t i = 0; i < sampleCount; ++i) {
-        *pOut++ = drwav__mulaw_to_s16(pIn[i]) / 32768.0f;
+    size_t i = 0;
+#ifdef DRWAV_SUPPORT_AVX2
+    if (drwav__has_avx2()) {
+        i = drwav__lookup_32__avx2(pOut, pIn, sampleCount, g_drwavMulawTableF32);
+    }
+#endif
+
+    for (; i < sampleCount; ++i) {
+        pOut[i] = g_drwavMulawTableF32[pIn[i]];
     }
 }
 
+// Deinterleaving of converted frames into one array per channel. Each kernel handles four frames at a time with a
+// register transpose, returns the number of frames it handled and leaves the rest to the scalar loop.
+#ifdef DRWAV_SUPPORT_SSE2
+static size_t drwav__deinterleave_f32_2__sse2(float** ppOut, const float* pIn, size_t frameCount)
+{
+    size_t i = 0;
+    for (; i + 4 <= frameCount; i += 4) {
+        __m128 a = _mm_loadu_ps(pIn + i*2 + 0);
+        __m128 b = _mm_loadu_ps(pIn + i*2 + 4);
+        _mm_storeu_ps(ppOut[0] + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(ppOut[1] + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    return i;
+}
+
+static size_t drwav__deinterleave_f32_4__sse2(float** ppOut, const float* pIn, size_t frameCount)
+{
+    size_t i = 0;
+    for (; i + 4 <= frameCount; i += 4) {
+        __m128 r0 = _mm_loadu_ps(pIn + i*4 +  0);
+        __m128 r1 = _mm_loadu_ps(pIn + i*4 +  4);
+        __m128 r2 = _mm_loadu_ps(pIn + i*4 +  8);
+        __m128 r3 = _mm_loadu_ps(pIn + i*4 + 12);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(ppOut[0] + i, r0);
+        _mm_storeu_ps(ppOut[1] + i, r1);
+        _mm_storeu_ps(ppOut[2] + i, r2);
+        _mm_storeu_ps(ppOut[3] + i, r3);
+    }
+    return i;
+}
+
+static size_t drwav__deinterleave_f32_6__sse2(float** ppOut, const float* pIn, size_t frameCount)
+{
+    size_t i = 0;
+    for (; i + 4 <= frameCount; i += 4) {
+        const float* pFrames = pIn + i*6;
+
+        // The first four channels are a 4x4 transpose, the last two are gathered in pairs and split.
+        __m128 r0 = _mm_loadu_ps(pFrames +  0);
+        __m128 r1 = _mm_loadu_ps(pFrames +  6);
+        __m128 r2 = _mm_loadu_ps(pFrames + 12);
+        __m128 r3 = _mm_loadu_ps(pFrames + 18);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(ppOut[0] + i, r0);
+        _mm_storeu_ps(ppOut[1] + i, r1);
+        _mm_storeu_ps(ppOut[2] + i, r2);
+        _mm_storeu_ps(ppOut[3] + i, r3);
+
+        __m128 lo = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(pFrames +  4)), (const __m64*)(pFrames + 10));
+        __m128 hi = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(pFrames + 16)), (const __m64*)(pFrames + 22));
+        _mm_storeu_ps(ppOut[4] + i, _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(ppOut[5] + i, _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    return i;
+}
+
+static size_t drwav__deinterleave_f32_8__sse2(float** ppOut, const float* pIn, size_t frameCount)
+{
+    size_t i = 0;
+    for (; i + 4 <= frameCount; i += 4) {
+        for (int half = 0; half < 8; half += 4) {
+            __m128 r0 = _mm_loadu_ps(pIn + i*8 + half +  0);
+            __m128 r1 = _mm_loadu_ps(pIn + i*8 + half +  8);
+            __m128 r2 = _mm_loadu_ps(pIn + i*8 + half + 16);
+            __m128 r3 = _mm_loadu_ps(pIn + i*8 + half + 24);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(ppOut[half + 0] + i, r0);
+            _mm_storeu_ps(ppOut[half + 1] + i, r1);
+            _mm_storeu_ps(ppOut[half + 2] + i, r2);
+            _mm_storeu_ps(ppOut[half + 3] + i, r3);
+        }
+    }
+    return i;
+}
+#endif
+
+static void drwav__deinterleave_f32(float** ppOut, const float* pIn, size_t frameCount, unsigned int channels)
+{
+    size_t i = 0;
+#ifdef DRWAV_SUPPORT_SSE2
+    switch (channels) {
+        case 2: i = drwav__deinterleave_f32_2__sse2(ppOut, pIn, frameCount); break;
+        case 4: i = drwav__deinterleave_f32_4__sse2(ppOut, pIn, frameCount); break;
+        case 6: i = drwav__deinterleave_f32_6__sse2(ppOut, pIn, frameCount); break;
+        case 8: i = drwav__deinterleave_f32_8__sse2(ppOut, pIn, frameCount); break;
+        default: break;
+    }
+#endif
+
+    for (unsigned int iChannel = 0; iChannel < channels; ++iChannel) {
+        float* pChannel = ppOut[iChannel];
+        for (size_t iFrame = i; iFrame < frameCount; ++iFrame) {
+            pChannel[iFrame] = pIn[iFrame*channels + iChannel];
+        }
+    }
+}
+
+drwav_uint64 drwav_read_f32_deinterleaved(drwav* pWav, drwav_uint64 framesToRead, float** ppChannelsOut)
+{
+    if (pWav == NULL || framesToRead == 0 || ppChannelsOut == NULL || pWav->channels == 0) {
+        return 0;
+    }
+
+    // A mono file needs no splitting.
+    unsigned int channels = pWav->channels;
+    if (channels == 1) {
+        return drwav_read_f32(pWav, framesToRead, ppChannelsOut[0]);
+    }
+
+    // Frames are converted a tile at a time and split while the tile is still in the L1 cache, so the output is the
+    // only pass over main memory. Files with too many channels for a tile are split one sample at a time.
+    float tile[8192];
+    size_t tileFrames = sizeof(tile)/sizeof(tile[0]) / channels;
+    if (tileFrames == 0) {
+        drwav_uint64 totalSamplesRead = 0;
+        while (totalSamplesRead < framesToRead*channels) {
+            float sample;
+            if (drwav_read_f32(pWav, 1, &sample) == 0) {
+                break;
+            }
+            ppChannelsOut[totalSamplesRead % channels][totalSamplesRead / channels] = sample;
+            totalSamplesRead += 1;
+        }
+        return totalSamplesRead / channels;
+    }
+
+    float* pChannels[8];
+    float** ppOut = ppChannelsOut;
+    if (channels <= 8) {
+        for (unsigned int iChannel = 0; iChannel < channels; ++iChannel) {
+            pChannels[iChannel] = ppChannelsOut[iChannel];
+        }
+        ppOut = pChannels;
+    }
+
+    drwav_uint64 totalFramesRead = 0;
+    while (totalFramesRead < framesToRead) {
+        size_t framesToConvert = (size_t)drwav_min(framesToRead - totalFramesRead, tileFrames);
+        size_t samplesRead = (size_t)drwav_read_f32(pWav, framesToConvert*channels, tile);
+        size_t framesRead = samplesRead / channels;
+
+        // The kernels write from the start of the pointers they are given, so they are moved along with the output.
+        if (ppOut == pChannels) {
+            drwav__deinterleave_f32(ppOut, tile, framesRead, channels);
+            for (unsigned int iChannel = 0; iChannel < channels; ++iChannel) {
+                pChannels[iChannel] += framesRead;
+            }
+        } else {
+            for (size_t i = 0; i < framesRead; ++i) {
+                for (unsigned int iChannel = 0; iChannel < channels; ++iChannel) {
+                    ppOut[iChannel][totalFramesRead + i] = tile[i*channels + iChannel];
+                }
+            }
+        }
+
+        totalFramesRead += framesRead;
+        if (framesRead < framesToConvert) {
+            break;
+        }
+    }
+
+    return totalFramesRead;
+}
+
 
 
 static void drwav__pcm_to_s32(drwav_int32* pOut, const unsigned char* pIn, size_t totalSampleCount, unsigned short bytesPerSample)
@@ -3092,6 +3605,11 @@ static void drwav__ieee_to_s32(drwav_int32* pOut, const unsigned char* pIn, size
 }
 
 
+static void drwav__convert_pcm_to_s32(void* pOut, const unsigned char* pIn, size_t sampleCount, unsigned short bytesPerSample)
+{
+    drwav__pcm_to_s32((drwav_int32*)pOut, pIn, sampleCount, bytesPerSample);
+}
+
 drwav_uint64 drwav_read_s32__pcm(drwav* pWav, drwav_uint64 samplesToRead, drwav_int32* pBufferOut)
 {
     // Fast path.
@@ -3103,22 +3621,7 @@ drwav_uint64 drwav_read_s32__pcm(drwav* pWav, drwav_uint64 samplesToRead, drwav_
         return 0;
     }
 
-    drwav_uint64 totalSamplesRead = 0;
-    unsigned char sampleData[4096];
-    while (samplesToRead > 0) {
-        drwav_uint64 samplesRead = drwav_read(pWav, drwav_min(samplesToRead, sizeof(sampleData)/pWav->bytesPerSample), sampleData);
-        if (samplesRead == 0) {
-            break;
-        }
-
-        drwav__pcm_to_s32(pBufferOut, sampleData, (size_t)samplesRead, pWav->bytesPerSample);
-
-        pBufferOut       += samplesRead;
-        samplesToRead    -= samplesRead;
-        totalSamplesRead += samplesRead;
-    }
-
-    return totalSamplesRead;
+    return drwav__read_and_convert(pWav, samplesToRead, pBufferOut, sizeof(*pBufferOut), drwav__convert_pcm_to_s32);
 }
 
 drwav_uint64 drwav_read_s32__msadpcm(drwav* pWav, drwav_uint64 samplesToRead, drwav_int32* pBufferOut)
@@ -3165,28 +3668,24 @@ drwav_uint64 drwav_read_s32__ima(drwav* pWav, drwav_uint64 samplesToRead, drwav_
     return totalSamplesRead;
 }
 
+static void drwav__convert_ieee_to_s32(void* pOut, const unsigned char* pIn, size_t sampleCount, unsigned short bytesPerSample)
+{
+    drwav__ieee_to_s32((drwav_int32*)pOut, pIn, sampleCount, bytesPerSample);
+}
+
 drwav_uint64 drwav_read_s32__ieee(drwav* pWav, drwav_uint64 samplesToRead, drwav_int32* pBufferOut)
 {
     if (pWav->bytesPerSample == 0) {
         return 0;
     }
 
-    drwav_uint64 totalSamplesRead = 0;
-    unsigned char sampleData[4096];
-    while (samplesToRead > 0) {
-        drwav_uint64 samplesRead = drwav_read(pWav, drwav_min(samplesToRead, sizeof(sampleData)/pWav->bytesPerSample), sampleData);
-        if (samplesRead == 0) {
-            break;
-        }
-
-        drwav__ieee_to_s32(pBufferOut, sampleData, (size_t)samplesRead, pWav->bytesPerSample);
-
-        pBufferOut       += samplesRead;
-        samplesToRead    -= samplesRead;
-        totalSamplesRead += samplesRead;
-    }
+    return drwav__read_and_convert(pWav, samplesToRead, pBufferOut, sizeof(*pBufferOut), drwav__convert_ieee_to_s32);
+}
 
-    return totalSamplesRead;
+static void drwav__convert_alaw_to_s32(void* pOut, const unsigned char* pIn, size_t sampleCount, unsigned short bytesPerSample)
+{
+    (void)bytesPerSample;
+    drwav_alaw_to_s32((drwav_int32*)pOut, pIn, sampleCount);
 }
 
 drwav_uint64 drwav_read_s32__alaw(drwav* pWav, drwav_uint64 samplesToRead, drwav_int32* pBufferOut)
@@ -3195,22 +3694,13 @@ drwav_uint64 drwav_read_s32__alaw(drwav* pWav, drwav_uint64 samplesToRead, drwav
         return 0;
     }
 
-    drwav_uint64 totalSamplesRead = 0;
-    unsigned char sampleData[4096];
-    while (samplesToRead > 0) {
-        drwav_uint64 samplesRead = drwav_read(pWav, drwav_min(samplesToRead, sizeof(sampleData)/pWav->bytesPerSample), sampleData);
-        if (samplesRead == 0) {
-            break;
-        }
-
-        drwav_alaw_to_s32(pBufferOut, sampleData, (size_t)samplesRead);
-
-        pBufferOut       += samplesRead;
-        samplesToRead    -= samplesRead;
-        totalSamplesRead += samplesRead;
-    }
+    return drwav__read_and_convert(pWav, samplesToRead, pBufferOut, sizeof(*pBufferOut), drwav__convert_alaw_to_s32);
+}
 
-    return totalSamplesRead;
+static void drwav__convert_mulaw_to_s32(void* pOut, const unsigned char* pIn, size_t sampleCount, unsigned short bytesPerSample)
+{
+    (void)bytesPerSample;
+    drwav_mulaw_to_s32((drwav_int32*)pOut, pIn, sampleCount);
 }
 
 drwav_uint64 drwav_read_s32__mulaw(drwav* pWav, drwav_uint64 samplesToRead, drwav_int32* pBufferOut)
@@ -3219,22 +3709,7 @@ drwav_uint64 drwav_read_s32__mulaw(drwav* pWav, drwav_uint64 samplesToRead, drwa
         return 0;
     }
 
-    drwav_uint64 totalSamplesRead = 0;
-    unsigned char sampleData[4096];
-    while (samplesToRead > 0) {
-        drwav_uint64 samplesRead = drwav_read(pWav, drwav_min(samplesToRead, sizeof(sampleData)/pWav->bytesPerSample), sampleData);
-        if (samplesRead == 0) {
-            break;
-        }
-
-        drwav_mulaw_to_s32(pBufferOut, sampleData, (size_t)samplesRead);
-
-        pBufferOut       += samplesRead;
-        samplesToRead    -= samplesRead;
-        totalSamplesRead += samplesRead;
-    }
-
-    return totalSamplesRead;
+    return drwav__read_and_convert(pWav, samplesToRead, pBufferOut, sizeof(*pBufferOut), drwav__convert_mulaw_to_s32);
 }
 
 drwav_uint64 drwav_read_s32(drwav* pWav, drwav_uint64 samplesToRead, drwav_int32* pBufferOut)
@@ -3342,8 +3817,15 @@ void drwav_alaw_to_s32(drwav_int32* pOut, const drwav_uint8* pIn, size_t sampleC
         return;
     }
 
-    for (size_t i = 0; i < sampleCount; ++i) {
-        *pOut++ = ((drwav_int32)drwav__alaw_to_s16(pIn[i])) << 16;
+    size_t i = 0;
+#ifdef DRWAV_SUPPORT_AVX2
+    if (drwav__has_avx2()) {
+        i = drwav__lookup_32__avx2(pOut, pIn, sampleCount, g_drwavAlawTableS32);
+    }
+#endif
+
+    for (; i < sampleCount; ++i) {
+        pOut[i] = g_drwavAlawTableS32[pIn[i]];
     }
 }
 
@@ -3353,8 +3835,214 @@ void drwav_mulaw_to_s32(drwav_int32* pOut, const drwav_uint8* pIn, size_t sample
         return;
     }
 
-    for (size_t i= 0; i < sampleCount; ++i) {
-        *pOut++ = ((drwav_int32)drwav__mulaw_to_s16(pIn[i])) << 16;
+    size_t i = 0;
+#ifdef DRWAV_SUPPORT_AVX2
+    if (drwav__has_avx2()) {
+        i = drwav__lookup_32__avx2(pOut, pIn, sampleCount, g_drwavMulawTableS32);
+    }
+#endif
+
+    for (; i < sampleCount; ++i) {
+        pOut[i] = g_drwavMulawTableS32[pIn[i]];
+    }
+}
+
+
+
+// The dither noise of the sample at each position is a hash of seed + position*DRWAV_DITHER_STEP. It only needs shifts,
+// xors and adds, so the SIMD kernels compute exactly the same noise as the scalar code.
+#define DRWAV_DITHER_STEP 0x9E3779B9U
+
+static DRWAV_INLINE float drwav__tpdf_noise(drwav_uint32 counter)
+{
+    drwav_uint32 h = counter;
+    h ^= h << 13;
+    h ^= h >> 17;
+    h ^= h << 5;
+
+    // The sum of two uniform 16-bit values has a triangular distribution. Every step here is exact in float.
+    return (float)(drwav_int32)((h & 0xFFFF) + (h >> 16) - 0xFFFF) * (1.0f / 65536.0f);
+}
+
+// Scales, dithers, clips and rounds one sample. <limit> is the smallest value that rounds past <maxValue>.
+static DRWAV_INLINE drwav_int32 drwav__f32_to_int_clipped_sample(float x, float scale, float limit, drwav_int32 maxValue, float noise)
+{
+    float v = x*scale + noise;
+    if (v != v) {
+        v = 0;
+    }
+    if (v < -scale) {
+        v = -scale;
+    }
+    if (v >= limit) {
+        return maxValue;
+    }
+    return (drwav_int32)lrintf(v);
+}
+
+// The kernels convert to 32-bit integers, which the public functions narrow down. Like the scalar code they round with
+// the current rounding mode, to nearest even by default.
+#ifdef DRWAV_SUPPORT_SSE2
+static size_t drwav__f32_to_int_clipped__sse2(drwav_int32* pOut, const float* pIn, size_t sampleCount, float scale, drwav_int32 maxValue, drwav_bool32 isDithered, drwav_uint32 seed)
+{
+    const __m128 scaleV = _mm_set1_ps(scale);
+    const __m128 lowV = _mm_set1_ps(-scale);
+    const __m128 limitV = _mm_set1_ps(scale - 0.5f);
+    const __m128i maxV = _mm_set1_epi32(maxValue);
+    const __m128i lowMask = _mm_set1_epi32(0xFFFF);
+    const __m128 noiseScale = _mm_set1_ps(1.0f / 65536.0f);
+
+    __m128i counter = _mm_add_epi32(_mm_set1_epi32((int)seed), _mm_setr_epi32(0, (int)DRWAV_DITHER_STEP, (int)(DRWAV_DITHER_STEP*2), (int)(DRWAV_DITHER_STEP*3)));
+    const __m128i counterStep = _mm_set1_epi32((int)(DRWAV_DITHER_STEP*4));
+
+    size_t i = 0;
+    for (; i + 4 <= sampleCount; i += 4) {
+        __m128 v = _mm_mul_ps(_mm_loadu_ps(pIn + i), scaleV);
+        if (isDithered) {
+            __m128i h = counter;
+            h = _mm_xor_si128(h, _mm_slli_epi32(h, 13));
+            h = _mm_xor_si128(h, _mm_srli_epi32(h, 17));
+            h = _mm_xor_si128(h, _mm_slli_epi32(h, 5));
+            __m128i sum = _mm_sub_epi32(_mm_add_epi32(_mm_and_si128(h, lowMask), _mm_srli_epi32(h, 16)), lowMask);
+            v = _mm_add_ps(v, _mm_mul_ps(_mm_cvtepi32_ps(sum), noiseScale));
+            counter = _mm_add_epi32(counter, counterStep);
+        }
+
+        // NaNs to zero, then clip. Values that would round past the top are replaced after the conversion.
+        v = _mm_and_ps(v, _mm_cmpeq_ps(v, v));
+        v = _mm_max_ps(v, lowV);
+        __m128i isTop = _mm_castps_si128(_mm_cmpge_ps(v, limitV));
+        __m128i r = _mm_cvtps_epi32(v);
+        r = _mm_or_si128(_mm_and_si128(isTop, maxV), _mm_andnot_si128(isTop, r));
+        _mm_storeu_si128((__m128i*)(pOut + i), r);
+    }
+    return i;
+}
+#endif
+
+#ifdef DRWAV_SUPPORT_AVX2
+DRWAV_TARGET_AVX2 static size_t drwav__f32_to_int_clipped__avx2(drwav_int32* pOut, const float* pIn, size_t sampleCount, float scale, drwav_int32 maxValue, drwav_bool32 isDithered, drwav_uint32 seed)
+{
+    const __m256 scaleV = _mm256_set1_ps(scale);
+    const __m256 lowV = _mm256_set1_ps(-scale);
+    const __m256 limitV = _mm256_set1_ps(scale - 0.5f);
+    const __m256i maxV = _mm256_set1_epi32(maxValue);
+    const __m256i lowMask = _mm256_set1_epi32(0xFFFF);
+    const __m256 noiseScale = _mm256_set1_ps(1.0f / 65536.0f);
+
+    __m256i counter = _mm256_add_epi32(_mm256_set1_epi32((int)seed), _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32((int)DRWAV_DITHER_STEP)));
+    const __m256i counterStep = _mm256_set1_epi32((int)(DRWAV_DITHER_STEP*8));
+
+    size_t i = 0;
+    for (; i + 8 <= sampleCount; i += 8) {
+        __m256 v = _mm256_mul_ps(_mm256_loadu_ps(pIn + i), scaleV);
+        if (isDithered) {
+            __m256i h = counter;
+            h = _mm256_xor_si256(h, _mm256_slli_epi32(h, 13));
+            h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 17));
+            h = _mm256_xor_si256(h, _mm256_slli_epi32(h, 5));
+            __m256i sum = _mm256_sub_epi32(_mm256_add_epi32(_mm256_and_si256(h, lowMask), _mm256_srli_epi32(h, 16)), lowMask);
+            v = _mm256_add_ps(v, _mm256_mul_ps(_mm256_cvtepi32_ps(sum), noiseScale));
+            counter = _mm256_add_epi32(counter, counterStep);
+        }
+
+        v = _mm256_and_ps(v, _mm256_cmp_ps(v, v, _CMP_EQ_OQ));
+        v = _mm256_max_ps(v, lowV);
+        __m256i isTop = _mm256_castps_si256(_mm256_cmp_ps(v, limitV, _CMP_GE_OQ));
+        __m256i r = _mm256_cvtps_epi32(v);
+        r = _mm256_blendv_epi8(r, maxV, isTop);
+        _mm256_storeu_si256((__m256i*)(pOut + i), r);
+    }
+    return i;
+}
+#endif
+
+// Converts to 32-bit integers in the range of the output type. <seed> is the dither counter of the first sample.
+static void drwav__f32_to_int_clipped(drwav_int32* pOut, const float* pIn, size_t sampleCount, float scale, drwav_int32 maxValue, drwav_bool32 isDithered, drwav_uint32 seed)
+{
+    size_t i = 0;
+#ifdef DRWAV_SUPPORT_AVX2
+    if (drwav__has_avx2()) {
+        i = drwav__f32_to_int_clipped__avx2(pOut, pIn, sampleCount, scale, maxValue, isDithered, seed);
+    }
+#endif
+#ifdef DRWAV_SUPPORT_SSE2
+    i += drwav__f32_to_int_clipped__sse2(pOut + i, pIn + i, sampleCount - i, scale, maxValue, isDithered, seed + (drwav_uint32)i*DRWAV_DITHER_STEP);
+#endif
+
+    float limit = scale - 0.5f;
+    for (; i < sampleCount; ++i) {
+        float noise = isDithered ? drwav__tpdf_noise(seed + (drwav_uint32)i*DRWAV_DITHER_STEP) : 0;
+        pOut[i] = drwav__f32_to_int_clipped_sample(pIn[i], scale, limit, maxValue, noise);
+    }
+}
+
+// Converts in pieces that fit a buffer on the stack and narrows each piece to 16 or packed 24-bit samples.
+static void drwav__f32_to_narrow_clipped(drwav_uint8* pOut, const float* pIn, size_t sampleCount, float scale, drwav_int32 maxValue, drwav_uint32* pDitherSeed, unsigned int bytesPerSample)
+{
+    drwav_uint32 seed = (pDitherSeed != NULL) ? *pDitherSeed : 0;
+
+    drwav_int32 buffer[256];
+    size_t samplesDone = 0;
+    while (samplesDone < sampleCount) {
+        size_t count = sampleCount - samplesDone;
+        if (count > drwav_countof(buffer)) {
+            count = drwav_countof(buffer);
+        }
+
+        drwav__f32_to_int_clipped(buffer, pIn + samplesDone, count, scale, maxValue, pDitherSeed != NULL, seed + (drwav_uint32)samplesDone*DRWAV_DITHER_STEP);
+        if (bytesPerSample == 2) {
+            drwav_int16* pOut16 = (drwav_int16*)pOut + samplesDone;
+            for (size_t i = 0; i < count; ++i) {
+                pOut16[i] = (drwav_int16)buffer[i];
+            }
+        } else {
+            drwav_uint8* pOut24 = pOut + samplesDone*3;
+            for (size_t i = 0; i < count; ++i) {
+                drwav_uint32 sample = (drwav_uint32)buffer[i];
+                pOut24[i*3 + 0] = (drwav_uint8)(sample >>  0);
+                pOut24[i*3 + 1] = (drwav_uint8)(sample >>  8);
+                pOut24[i*3 + 2] = (drwav_uint8)(sample >> 16);
+            }
+        }
+
+        samplesDone += count;
+    }
+
+    if (pDitherSeed != NULL) {
+        *pDitherSeed = seed + (drwav_uint32)sampleCount*DRWAV_DITHER_STEP;
+    }
+}
+
+void drwav_f32_to_s16_clipped(drwav_int16* pOut, const float* pIn, size_t sampleCount, drwav_uint32* pDitherSeed)
+{
+    if (pOut == NULL || pIn == NULL) {
+        return;
+    }
+
+    drwav__f32_to_narrow_clipped((drwav_uint8*)pOut, pIn, sampleCount, 32768.0f, 32767, pDitherSeed, 2);
+}
+
+void drwav_f32_to_s24_clipped(drwav_uint8* pOut, const float* pIn, size_t sampleCount, drwav_uint32* pDitherSeed)
+{
+    if (pOut == NULL || pIn == NULL) {
+        return;
+    }
+
+    drwav__f32_to_narrow_clipped(pOut, pIn, sampleCount, 8388608.0f, 8388607, pDitherSeed, 3);
+}
+
+void drwav_f32_to_s32_clipped(drwav_int32* pOut, const float* pIn, size_t sampleCount, drwav_uint32* pDitherSeed)
+{
+    if (pOut == NULL || pIn == NULL) {
+        return;
+    }
+
+    drwav_uint32 seed = (pDitherSeed != NULL) ? *pDitherSeed : 0;
+    drwav__f32_to_int_clipped(pOut, pIn, sampleCount, 2147483648.0f, 0x7FFFFFFF, pDitherSeed != NULL, seed);
+
+    if (pDitherSeed != NULL) {
+        *pDitherSeed = seed + (drwav_uint32)sampleCount*DRWAV_DITHER_STEP;
     }
 }
 
@@ -3594,6 +4282,11 @@ void drwav_free(void* pDataReturnedByOpenAndRead)
 
 // REVISION HISTORY
 //
+// Local changes on top of v0.8.1, made for this plugin:
+//   - ABI CHANGE. The msadpcm and ima members of drwav are removed. The MS-ADPCM and IMA decoders now decode a whole
+//     block at a time into a buffer kept in drwav::compressed, which drwav_init() allocates and drwav_uninit() frees.
+//     Code compiled against the upstream header can't share drwav objects with code compiled against this one.
+//
 // v0.8.1 - 2018-06-29
 //   - Add support for sequential writing APIs.
 //   - Disable seeking in write mode.
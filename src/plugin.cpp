@@ -1,4 +1,6 @@
 #include "plugin.hpp"
+#include "SampleCache.hpp"
+#include "FileReader.hpp"
 
 
 Plugin* pluginInstance;
@@ -13,4 +15,44 @@ void init(Plugin* p) {
 
 	// Any other plugin initialization may go here.
 	// As an alternative, consider lazy-loading assets and lookup tables when your module is created to reduce startup times of Rack.
+	loadSettings();
+}
+
+
+/**
+ * Read the plugin wide settings from the user folder.
+ */
+void loadSettings() {
+	json_t* rootJ = json_load_file(asset::user("TestPlugin.json").c_str(), 0, NULL);
+	if (!rootJ) {
+		return;
+	}
+
+	json_t* budgetJ = json_object_get(rootJ, "sampleMemoryBudget");
+	if (budgetJ) {
+		SampleCache::global().setBudget(size_t(json_integer_value(budgetJ)) << 20);
+	}
+
+	json_t* backendJ = json_object_get(rootJ, "fileBackend");
+	if (json_is_string(backendJ)) {
+		for (int i = 0; i < FileReader::NUM_BACKENDS; i++) {
+			FileReader::Backend backend = static_cast<FileReader::Backend>(i);
+			if (std::string(json_string_value(backendJ)) == FileReader::getBackendName(backend)) {
+				FileReader::setBackend(backend);
+			}
+		}
+	}
+
+	json_decref(rootJ);
+}
+
+/**
+ * Write the plugin wide settings to the user folder.
+ */
+void saveSettings() {
+	json_t* rootJ = json_object();
+	json_object_set_new(rootJ, "sampleMemoryBudget", json_integer(SampleCache::global().getBudget() >> 20));
+	json_object_set_new(rootJ, "fileBackend", json_string(FileReader::getBackendName(FileReader::getBackend())));
+	json_dump_file(rootJ, asset::user("TestPlugin.json").c_str(), JSON_INDENT(2));
+	json_decref(rootJ);
 }
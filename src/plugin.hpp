@@ -10,3 +10,7 @@ extern Plugin* pluginInstance;
 // Declare each Model, defined in each module source file
 extern Model* modelMyModule;
 extern Model* modelWavPlay;
+
+// Plugin wide settings, stored in the Rack user folder
+void loadSettings();
+void saveSettings();
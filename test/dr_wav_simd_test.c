@@ -0,0 +1,253 @@
+// Checks that the SIMD sample conversion kernels in dr_wav.h give bit for bit the same output as the scalar code
+// they replace.
+//
+// Every kernel runs over random and edge case input at every length up to a few vectors and at every offset within
+// a vector, so the tails the kernels leave to the scalar loop and unaligned loads are covered. The input of each
+// call is copied to a buffer of exactly its size, so a kernel reading past its input shows up under the address
+// sanitizer. The public conversion functions, which pick the kernels at runtime, are checked the same way.
+//
+// The reference functions are the scalar loops of dr_wav from before the kernels were added.
+#define DR_WAV_IMPLEMENTATION
+#include "dr_wav.h"
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_MAX_LENGTH 131         // eight loops of the widest kernels, 16 samples each, and a tail
+#define TEST_MAX_OFFSET 8
+#define TEST_LONG_LENGTH 65541
+#define TEST_POOL_BYTES ((TEST_LONG_LENGTH + TEST_MAX_OFFSET) * 8)
+#define TEST_GUARD 16               // samples after the output that no kernel may write
+
+static drwav_uint32 g_seed = 1;
+
+static drwav_uint32 test_random()
+{
+    // xorshift32
+    g_seed ^= g_seed << 13;
+    g_seed ^= g_seed >> 17;
+    g_seed ^= g_seed << 5;
+    return g_seed;
+}
+
+
+static void reference_u8_to_f32(float* pOut, const drwav_uint8* pIn, size_t sampleCount)
+{
+    for (size_t i = 0; i < sampleCount; ++i) {
+        *pOut++ = (pIn[i] / 255.0f) * 2 - 1;
+    }
+}
+
+static void reference_s16_to_f32(float* pOut, const drwav_uint8* pIn, size_t sampleCount)
+{
+    const drwav_int16* pSamples = (const drwav_int16*)pIn;
+    for (size_t i = 0; i < sampleCount; ++i) {
+        *pOut++ = pSamples[i] / 32768.0f;
+    }
+}
+
+static void reference_s24_to_f32(float* pOut, const drwav_uint8* pIn, size_t sampleCount)
+{
+    for (size_t i = 0; i < sampleCount; ++i) {
+        unsigned int s0 = pIn[i*3 + 0];
+        unsigned int s1 = pIn[i*3 + 1];
+        unsigned int s2 = pIn[i*3 + 2];
+
+        int sample32 = (int)((s0 << 8) | (s1 << 16) | (s2 << 24));
+        *pOut++ = (float)(sample32 / 2147483648.0);
+    }
+}
+
+static void reference_s32_to_f32(float* pOut, const drwav_uint8* pIn, size_t sampleCount)
+{
+    const drwav_int32* pSamples = (const drwav_int32*)pIn;
+    for (size_t i = 0; i < sampleCount; ++i) {
+        *pOut++ = (float)(pSamples[i] / 2147483648.0);
+    }
+}
+
+static void reference_f64_to_f32(float* pOut, const drwav_uint8* pIn, size_t sampleCount)
+{
+    const double* pSamples = (const double*)pIn;
+    for (size_t i = 0; i < sampleCount; ++i) {
+        *pOut++ = (float)pSamples[i];
+    }
+}
+
+static void reference_alaw_to_f32(float* pOut, const drwav_uint8* pIn, size_t sampleCount)
+{
+    for (size_t i = 0; i < sampleCount; ++i) {
+        *pOut++ = drwav__alaw_to_s16(pIn[i]) / 32768.0f;
+    }
+}
+
+static void reference_mulaw_to_f32(float* pOut, const drwav_uint8* pIn, size_t sampleCount)
+{
+    for (size_t i = 0; i < sampleCount; ++i) {
+        *pOut++ = drwav__mulaw_to_s16(pIn[i]) / 32768.0f;
+    }
+}
+
+
+// The kernels and public functions take typed input, these wrappers give them all the same signature. A kernel
+// returns how many samples it converted, the public functions convert all of them.
+#ifdef DRWAV_SUPPORT_SSE2
+static size_t sse2_u8(float* o, const drwav_uint8* p, size_t n)  { return drwav__u8_to_f32__sse2(o, p, n); }
+static size_t sse2_s16(float* o, const drwav_uint8* p, size_t n) { return drwav__s16_to_f32__sse2(o, (const drwav_int16*)p, n); }
+static size_t sse2_s32(float* o, const drwav_uint8* p, size_t n) { return drwav__s32_to_f32__sse2(o, (const drwav_int32*)p, n); }
+static size_t sse2_f64(float* o, const drwav_uint8* p, size_t n) { return drwav__f64_to_f32__sse2(o, (const double*)p, n); }
+#endif
+#ifdef DRWAV_SUPPORT_AVX2
+static size_t avx2_u8(float* o, const drwav_uint8* p, size_t n)    { return drwav__u8_to_f32__avx2(o, p, n); }
+static size_t avx2_s16(float* o, const drwav_uint8* p, size_t n)   { return drwav__s16_to_f32__avx2(o, (const drwav_int16*)p, n); }
+static size_t avx2_s24(float* o, const drwav_uint8* p, size_t n)   { return drwav__s24_to_f32__avx2(o, p, n); }
+static size_t avx2_s32(float* o, const drwav_uint8* p, size_t n)   { return drwav__s32_to_f32__avx2(o, (const drwav_int32*)p, n); }
+static size_t avx2_f64(float* o, const drwav_uint8* p, size_t n)   { return drwav__f64_to_f32__avx2(o, (const double*)p, n); }
+static size_t avx2_alaw(float* o, const drwav_uint8* p, size_t n)  { return drwav__lookup_32__avx2(o, p, n, g_drwavAlawTableF32); }
+static size_t avx2_mulaw(float* o, const drwav_uint8* p, size_t n) { return drwav__lookup_32__avx2(o, p, n, g_drwavMulawTableF32); }
+#endif
+static size_t public_u8(float* o, const drwav_uint8* p, size_t n)    { drwav_u8_to_f32(o, p, n); return n; }
+static size_t public_s16(float* o, const drwav_uint8* p, size_t n)   { drwav_s16_to_f32(o, (const drwav_int16*)p, n); return n; }
+static size_t public_s24(float* o, const drwav_uint8* p, size_t n)   { drwav_s24_to_f32(o, p, n); return n; }
+static size_t public_s32(float* o, const drwav_uint8* p, size_t n)   { drwav_s32_to_f32(o, (const drwav_int32*)p, n); return n; }
+static size_t public_f64(float* o, const drwav_uint8* p, size_t n)   { drwav_f64_to_f32(o, (const double*)p, n); return n; }
+static size_t public_alaw(float* o, const drwav_uint8* p, size_t n)  { drwav_alaw_to_f32(o, p, n); return n; }
+static size_t public_mulaw(float* o, const drwav_uint8* p, size_t n) { drwav_mulaw_to_f32(o, p, n); return n; }
+
+typedef struct
+{
+    const char* name;
+    size_t bytesPerSample;
+    void (* reference)(float* pOut, const drwav_uint8* pIn, size_t sampleCount);
+    size_t (* convert)(float* pOut, const drwav_uint8* pIn, size_t sampleCount);
+    drwav_bool32 needsAVX2;
+} test_case;
+
+
+// Random bytes, with the edge cases of each format at the start of the pool.
+static void fill_pool(drwav_uint8* pPool, size_t bytesPerSample)
+{
+    for (size_t i = 0; i < TEST_POOL_BYTES; ++i) {
+        pPool[i] = (drwav_uint8)(test_random() >> 24);
+    }
+
+    if (bytesPerSample == 1) {
+        for (int i = 0; i < 256; ++i) {
+            pPool[i] = (drwav_uint8)i;
+        }
+    } else if (bytesPerSample == 2) {
+        static const drwav_int16 edges[] = {0, 1, -1, 32767, -32768, -32767, 16384, -16384};
+        memcpy(pPool, edges, sizeof(edges));
+    } else if (bytesPerSample == 3) {
+        // little endian: 0x800000, 0x7FFFFF, 0xFFFFFF, 0x000001, 0x000000, 0x400000
+        static const drwav_uint8 edges[] = {0x00,0x00,0x80, 0xFF,0xFF,0x7F, 0xFF,0xFF,0xFF, 0x01,0x00,0x00, 0x00,0x00,0x00, 0x00,0x00,0x40};
+        memcpy(pPool, edges, sizeof(edges));
+    } else if (bytesPerSample == 4) {
+        // values with more than 24 significant bits round in the conversion to float
+        static const drwav_int32 edges[] = {INT_MAX, INT_MIN, INT_MIN + 1, 0, -1, 1, 0x7FFFFFC0, 0x7FFFFF80, 0x7FFFFF7F,
+            0x01000001, 0x01000003, -0x01000001, -0x01000003, 0x00FFFFFF, 0x40000040};
+        memcpy(pPool, edges, sizeof(edges));
+    } else if (bytesPerSample == 8) {
+        // in range values, every other one keeps its random bits, which include NaNs and infinities
+        double* pSamples = (double*)pPool;
+        for (size_t i = 0; i < TEST_POOL_BYTES / 8; i += 2) {
+            pSamples[i] = (test_random() / 4294967296.0) * 3 - 1.5;
+        }
+        static const double edges[] = {0.0, -0.0, 1e-40, -1e-40, 1e-46, FLT_MIN, FLT_MAX, -FLT_MAX, 3.4e39, -3.4e39,
+            HUGE_VAL, -HUGE_VAL, NAN, 1.0 + 1.0/16777216, 1.0 + 3.0/16777216, -1.0 - 1.0/16777216, 1.0, -1.0};
+        memcpy(pPool, edges, sizeof(edges));
+    }
+}
+
+// Runs a kernel over a span of the pool, returns DRWAV_FALSE if its output differs from the reference.
+static drwav_bool32 check_span(const test_case* pTest, const drwav_uint8* pPool, size_t offset, size_t length)
+{
+    static float expected[TEST_LONG_LENGTH + TEST_GUARD];
+    static float actual[TEST_LONG_LENGTH + TEST_GUARD];
+
+    size_t bytes = length * pTest->bytesPerSample;
+    drwav_uint8* pIn = (drwav_uint8*)malloc(bytes > 0 ? bytes : 1);
+    memcpy(pIn, pPool + offset * pTest->bytesPerSample, bytes);
+
+    memset(actual, 0x5A, sizeof(actual));
+    memset(expected, 0x5A, sizeof(expected));
+    size_t converted = pTest->convert(actual, pIn, length);
+    drwav_bool32 isSame = converted <= length;
+    if (isSame) {
+        pTest->reference(expected, pIn, converted);
+        isSame = memcmp(expected, actual, (converted + TEST_GUARD) * sizeof(float)) == 0;
+    }
+    if (!isSame) {
+        printf("%s: mismatch at offset %u, length %u\n", pTest->name, (unsigned int)offset, (unsigned int)length);
+    }
+
+    free(pIn);
+    return isSame;
+}
+
+int main()
+{
+    static drwav_uint8 pool[TEST_POOL_BYTES];
+    const test_case tests[] = {
+#ifdef DRWAV_SUPPORT_SSE2
+        {"u8 sse2",      1, reference_u8_to_f32,    sse2_u8,      DRWAV_FALSE},
+        {"s16 sse2",     2, reference_s16_to_f32,   sse2_s16,     DRWAV_FALSE},
+        {"s32 sse2",     4, reference_s32_to_f32,   sse2_s32,     DRWAV_FALSE},
+        {"f64 sse2",     8, reference_f64_to_f32,   sse2_f64,     DRWAV_FALSE},
+#endif
+#ifdef DRWAV_SUPPORT_AVX2
+        {"u8 avx2",      1, reference_u8_to_f32,    avx2_u8,      DRWAV_TRUE},
+        {"s16 avx2",     2, reference_s16_to_f32,   avx2_s16,     DRWAV_TRUE},
+        {"s24 avx2",     3, reference_s24_to_f32,   avx2_s24,     DRWAV_TRUE},
+        {"s32 avx2",     4, reference_s32_to_f32,   avx2_s32,     DRWAV_TRUE},
+        {"f64 avx2",     8, reference_f64_to_f32,   avx2_f64,     DRWAV_TRUE},
+        {"alaw avx2",    1, reference_alaw_to_f32,  avx2_alaw,    DRWAV_TRUE},
+        {"mulaw avx2",   1, reference_mulaw_to_f32, avx2_mulaw,   DRWAV_TRUE},
+#endif
+        {"u8 public",    1, reference_u8_to_f32,    public_u8,    DRWAV_FALSE},
+        {"s16 public",   2, reference_s16_to_f32,   public_s16,   DRWAV_FALSE},
+        {"s24 public",   3, reference_s24_to_f32,   public_s24,   DRWAV_FALSE},
+        {"s32 public",   4, reference_s32_to_f32,   public_s32,   DRWAV_FALSE},
+        {"f64 public",   8, reference_f64_to_f32,   public_f64,   DRWAV_FALSE},
+        {"alaw public",  1, reference_alaw_to_f32,  public_alaw,  DRWAV_FALSE},
+        {"mulaw public", 1, reference_mulaw_to_f32, public_mulaw, DRWAV_FALSE},
+    };
+
+    drwav_bool32 hasAVX2 = DRWAV_FALSE;
+#ifdef DRWAV_SUPPORT_AVX2
+    hasAVX2 = drwav__has_avx2();
+#endif
+
+    int failures = 0;
+    for (size_t iTest = 0; iTest < sizeof(tests) / sizeof(tests[0]); ++iTest) {
+        const test_case* pTest = &tests[iTest];
+        if (pTest->needsAVX2 && !hasAVX2) {
+            printf("%-13s skipped, no AVX2\n", pTest->name);
+            continue;
+        }
+
+        int spans = 0;
+        drwav_bool32 isSame = DRWAV_TRUE;
+        for (int iPool = 0; iPool < 4 && isSame; ++iPool) {
+            fill_pool(pool, pTest->bytesPerSample);
+            for (size_t offset = 0; offset < TEST_MAX_OFFSET && isSame; ++offset) {
+                for (size_t length = 0; length <= TEST_MAX_LENGTH && isSame; ++length) {
+                    isSame = check_span(pTest, pool, offset, length);
+                    spans += 1;
+                }
+            }
+            if (isSame) {
+                isSame = check_span(pTest, pool, iPool, TEST_LONG_LENGTH);
+                spans += 1;
+            }
+        }
+
+        printf("%-13s %s, %d spans\n", pTest->name, isSame ? "ok" : "FAILED", spans);
+        failures += isSame ? 0 : 1;
+    }
+
+    return failures == 0 ? 0 : 1;
+}